@@ -6,8 +6,6 @@ if len(sys.argv) != 4:
     sys.exit(1)
 
 key_type, pem_file, out_file = sys.argv[1], sys.argv[2], sys.argv[3]
-KEY_BYTES = 128
-
 with open(pem_file, "rb") as f:
     pem_data = f.read()
 
@@ -21,9 +19,18 @@ else: # private
     numbers = key.private_numbers()
     modulus = numbers.public_numbers.n
     exponent = numbers.d
+    # CRT parameters, appended after n and d for faster decryption
+    crt = [numbers.p, numbers.q, numbers.dmp1, numbers.dmq1, numbers.iqmp]
+
+# Field sizes follow the key, so 1024 to 4096-bit keys all work
+KEY_BYTES = key.key_size // 8
+PRIME_BYTES = KEY_BYTES // 2
 
 with open(out_file, "wb") as f:
     f.write(modulus.to_bytes(KEY_BYTES, 'big'))
     f.write(exponent.to_bytes(KEY_BYTES, 'big'))
+    if key_type != "public":
+        for value in crt:
+            f.write(value.to_bytes(PRIME_BYTES, 'big'))
 
 print(f"Successfully converted {pem_file} to {out_file}")
\ No newline at end of file
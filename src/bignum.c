@@ -2,21 +2,49 @@
 #include <string.h>
 #include <stdio.h>
 
+// 128-bit intermediate for 64x64-bit limb products (GCC/Clang extension)
+__extension__ typedef unsigned __int128 bn_dword;
+
 // --- Helper (private) functions for bignum arithmetic ---
+// Only words[0 .. len) are meaningful; limbs past len read as zero and are never touched.
+
+// Limb i of n, zero past the used length
+static uint64_t bignum_limb(const Bignum* n, size_t i) {
+    return i < n->len ? n->words[i] : 0;
+}
+
+// Drops leading zero limbs so len is minimal
+static void bignum_trim(Bignum* n) {
+    while (n->len > 0 && n->words[n->len - 1] == 0) n->len--;
+}
+
+// Resizes n to exactly len limbs, zero-extending. The value must fit in len limbs.
+static void bignum_pad(Bignum* n, size_t len) {
+    bignum_trim(n);
+    for (size_t i = n->len; i < len; ++i) n->words[i] = 0;
+    n->len = len;
+}
 
 // Sets a bignum to zero
 static void bignum_zero(Bignum* n) {
-    memset(n->words, 0, sizeof(n->words));
+    n->len = 0;
+}
+
+// Sets a bignum to a single-limb value
+static void bignum_set_word(Bignum* n, uint64_t v) {
+    n->words[0] = v;
+    n->len = 1;
 }
 
 // Copies a bignum
 static void bignum_copy(Bignum* dest, const Bignum* src) {
-    memcpy(dest->words, src->words, sizeof(src->words));
+    memmove(dest->words, src->words, src->len * sizeof(uint64_t));
+    dest->len = src->len;
 }
 
 // Checks if a bignum is zero
 static int bignum_is_zero(const Bignum* n) {
-    for (int i = 0; i < BIGNUM_WORDS; ++i) {
+    for (size_t i = 0; i < n->len; ++i) {
         if (n->words[i] != 0) return 0;
     }
     return 1;
@@ -24,71 +52,124 @@ static int bignum_is_zero(const Bignum* n) {
 
 // Compares two bignums: returns -1 (a<b), 0 (a=b), 1 (a>b)
 static int bignum_cmp(const Bignum* a, const Bignum* b) {
-    for (int i = BIGNUM_WORDS - 1; i >= 0; --i) {
-        if (a->words[i] > b->words[i]) return 1;
-        if (a->words[i] < b->words[i]) return -1;
+    size_t len = a->len > b->len ? a->len : b->len;
+    for (size_t i = len; i-- > 0;) {
+        uint64_t ai = bignum_limb(a, i), bi = bignum_limb(b, i);
+        if (ai > bi) return 1;
+        if (ai < bi) return -1;
     }
     return 0;
 }
 
-// Left shift by one bit
-static void bignum_lshift1(Bignum* n) {
-    uint32_t carry = 0;
-    for (int i = 0; i < BIGNUM_WORDS; ++i) {
-        uint32_t next_carry = (n->words[i] >> 31);
+// Number of significant bits in a bignum
+static size_t bignum_bit_length(const Bignum* n) {
+    for (size_t i = n->len; i-- > 0;) {
+        if (n->words[i] != 0) {
+            return i * 64 + 64 - __builtin_clzll(n->words[i]);
+        }
+    }
+    return 0;
+}
+
+// Returns bit i of a bignum
+static int bignum_get_bit(const Bignum* n, size_t i) {
+    return (bignum_limb(n, i / 64) >> (i % 64)) & 1;
+}
+
+// Left shift by one bit, growing len when the top bit moves into a new limb.
+// Returns the bit shifted out when the bignum is already at full capacity.
+static uint64_t bignum_lshift1(Bignum* n) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n->len; ++i) {
+        uint64_t next_carry = (n->words[i] >> 63);
         n->words[i] = (n->words[i] << 1) | carry;
         carry = next_carry;
     }
+    if (carry && n->len < BIGNUM_WORDS) {
+        n->words[n->len++] = carry;
+        carry = 0;
+    }
+    return carry;
 }
 
 // Right shift by one bit
 static void bignum_rshift1(Bignum* n) {
-    uint32_t carry = 0;
-    for (int i = BIGNUM_WORDS - 1; i >= 0; --i) {
-        uint32_t next_carry = (n->words[i] & 1);
-        n->words[i] = (n->words[i] >> 1) | (carry << 31);
+    uint64_t carry = 0;
+    for (size_t i = n->len; i-- > 0;) {
+        uint64_t next_carry = (n->words[i] & 1);
+        n->words[i] = (n->words[i] >> 1) | (carry << 63);
         carry = next_carry;
     }
+    bignum_trim(n);
 }
 
-// Addition: res = a + b. Returns carry.
-static uint32_t bignum_add(Bignum* res, const Bignum* a, const Bignum* b) {
-    uint64_t carry = 0;
-    for (int i = 0; i < BIGNUM_WORDS; ++i) {
-        uint64_t sum = (uint64_t)a->words[i] + b->words[i] + carry;
-        res->words[i] = (uint32_t)sum;
-        carry = sum >> 32;
+// Addition: res = a + b. Returns carry out of the full capacity.
+static uint64_t bignum_add(Bignum* res, const Bignum* a, const Bignum* b) {
+    size_t len = a->len > b->len ? a->len : b->len;
+    bn_dword carry = 0;
+    for (size_t i = 0; i < len; ++i) {
+        bn_dword sum = (bn_dword)bignum_limb(a, i) + bignum_limb(b, i) + carry;
+        res->words[i] = (uint64_t)sum;
+        carry = sum >> 64;
+    }
+    if (carry && len < BIGNUM_WORDS) {
+        res->words[len++] = 1;
+        carry = 0;
     }
-    return (uint32_t)carry;
+    res->len = len;
+    return (uint64_t)carry;
 }
 
 // Subtraction: res = a - b. Returns borrow.
-static uint32_t bignum_sub(Bignum* res, const Bignum* a, const Bignum* b) {
+static uint64_t bignum_sub(Bignum* res, const Bignum* a, const Bignum* b) {
+    size_t len = a->len > b->len ? a->len : b->len;
     uint64_t borrow = 0;
-    for (int i = 0; i < BIGNUM_WORDS; ++i) {
-        uint64_t diff = (uint64_t)a->words[i] - b->words[i] - borrow;
-        res->words[i] = (uint32_t)diff;
-        borrow = (diff >> 63) & 1;
+    for (size_t i = 0; i < len; ++i) {
+        uint64_t ai = bignum_limb(a, i), bi = bignum_limb(b, i);
+        uint64_t diff = ai - bi - borrow;
+        borrow = (ai < bi) | ((ai == bi) & borrow);
+        res->words[i] = diff;
     }
-    return (uint32_t)borrow;
+    res->len = len;
+    bignum_trim(res);
+    return borrow;
 }
 
 // Modular addition: res = (a + b) % mod
 static void bignum_mod_add(Bignum* res, const Bignum* a, const Bignum* b, const Bignum* mod) {
-    bignum_add(res, a, b);
-    if (bignum_cmp(res, mod) >= 0) {
+    uint64_t carry = bignum_add(res, a, b);
+    if (carry || bignum_cmp(res, mod) >= 0) {
         bignum_sub(res, res, mod);
     }
 }
 
+// Reduction: res = a % mod, one bit at a time. Only used on cold paths.
+static void bignum_mod(Bignum* res, const Bignum* a, const Bignum* mod) {
+    Bignum r;
+    bignum_zero(&r);
+    for (size_t i = bignum_bit_length(a); i-- > 0;) {
+        uint64_t carry = bignum_lshift1(&r);
+        if (bignum_get_bit(a, i)) {
+            if (r.len == 0) bignum_set_word(&r, 0);
+            r.words[0] |= 1;
+        }
+        if (carry || bignum_cmp(&r, mod) >= 0) {
+            bignum_sub(&r, &r, mod);
+        }
+    }
+    bignum_copy(res, &r);
+}
+
 // Modular multiplication: res = (a * b) % mod
+// Bit-serial fallback for even moduli, which Montgomery form cannot handle.
 static void bignum_mod_mul(Bignum* res, const Bignum* a, const Bignum* b, const Bignum* mod) {
     Bignum temp_res, temp_a;
     bignum_zero(&temp_res);
     bignum_copy(&temp_a, a);
 
-    for (int i = 0; i < BIGNUM_WORDS * 32; ++i) {
-        if ((b->words[i / 32] >> (i % 32)) & 1) {
+    size_t bits = bignum_bit_length(b);
+    for (size_t i = 0; i < bits; ++i) {
+        if (bignum_get_bit(b, i)) {
             bignum_mod_add(&temp_res, &temp_res, &temp_a, mod);
         }
         bignum_mod_add(&temp_a, &temp_a, &temp_a, mod);
@@ -96,45 +177,300 @@ static void bignum_mod_mul(Bignum* res, const Bignum* a, const Bignum* b, const
     bignum_copy(res, &temp_res);
 }
 
+// Multiplication: res = a * b, truncated to BIGNUM_WORDS limbs
+static void bignum_mul(Bignum* res, const Bignum* a, const Bignum* b) {
+    uint64_t t[BIGNUM_WORDS] = {0};
+    size_t a_len = (bignum_bit_length(a) + 63) / 64;
+    size_t b_len = (bignum_bit_length(b) + 63) / 64;
+    size_t len = a_len + b_len < BIGNUM_WORDS ? a_len + b_len : BIGNUM_WORDS;
+
+    for (size_t i = 0; i < b_len; ++i) {
+        bn_dword c = 0;
+        for (size_t j = 0; j < a_len && i + j < BIGNUM_WORDS; ++j) {
+            c = (bn_dword)a->words[j] * b->words[i] + t[i + j] + (uint64_t)(c >> 64);
+            t[i + j] = (uint64_t)c;
+        }
+        if (i + a_len < BIGNUM_WORDS) t[i + a_len] = (uint64_t)(c >> 64);
+    }
+    memcpy(res->words, t, len * sizeof(uint64_t));
+    res->len = len;
+    bignum_trim(res);
+}
+
+// --- Montgomery arithmetic ---
+
+// Montgomery multiplication (CIOS): res = a * b * R^-1 % n.
+// a and b must be below n and padded to exactly ctx->limbs limbs, and so is res;
+// res may alias a or b.
+static void bignum_mont_mul(Bignum* res, const Bignum* a, const Bignum* b, const BignumMont* ctx) {
+    const size_t s = ctx->limbs;
+    const uint64_t* n = ctx->mod.words;
+    uint64_t t[BIGNUM_WORDS + 2] = {0};
+
+    for (size_t i = 0; i < s; ++i) {
+        // t += a * b[i]
+        uint64_t bi = b->words[i];
+        bn_dword c = 0;
+        for (size_t j = 0; j < s; ++j) {
+            c = (bn_dword)a->words[j] * bi + t[j] + (uint64_t)(c >> 64);
+            t[j] = (uint64_t)c;
+        }
+        c = (bn_dword)t[s] + (uint64_t)(c >> 64);
+        t[s] = (uint64_t)c;
+        t[s + 1] = (uint64_t)(c >> 64);
+
+        // t = (t + m * n) / 2^64, with m chosen so the low limb cancels
+        uint64_t m = t[0] * ctx->n0inv;
+        c = (bn_dword)m * n[0] + t[0];
+        for (size_t j = 1; j < s; ++j) {
+            c = (bn_dword)m * n[j] + t[j] + (uint64_t)(c >> 64);
+            t[j - 1] = (uint64_t)c;
+        }
+        c = (bn_dword)t[s] + (uint64_t)(c >> 64);
+        t[s - 1] = (uint64_t)c;
+        t[s] = t[s + 1] + (uint64_t)(c >> 64);
+    }
+
+    // t < 2n here; one conditional subtraction brings it into [0, n)
+    uint64_t diff[BIGNUM_WORDS];
+    uint64_t borrow = 0;
+    for (size_t j = 0; j < s; ++j) {
+        uint64_t tj = t[j], nj = n[j];
+        diff[j] = tj - nj - borrow;
+        borrow = (tj < nj) | ((tj == nj) & borrow);
+    }
+    int use_diff = t[s] != 0 || !borrow;
+    for (size_t j = 0; j < s; ++j) {
+        res->words[j] = use_diff ? diff[j] : t[j];
+    }
+    res->len = s;
+}
+
+// Reduction: res = a % n for any a of up to 2 * limbs limbs, using Montgomery
+// multiplies instead of the bit-serial loop. Splits a = hi * R + lo.
+// The result is padded to ctx->limbs limbs, ready for bignum_mont_mul.
+static void bignum_mod_mont(Bignum* res, const Bignum* a, const BignumMont* ctx) {
+    const size_t s = ctx->limbs;
+    if (bignum_cmp(a, &ctx->mod) < 0) {
+        bignum_copy(res, a);
+        bignum_pad(res, s);
+        return;
+    }
+    if (bignum_bit_length(a) > 128 * s) {
+        bignum_mod(res, a, &ctx->mod);
+        bignum_pad(res, s);
+        return;
+    }
+
+    Bignum hi, lo, one;
+    for (size_t i = 0; i < s; ++i) {
+        lo.words[i] = bignum_limb(a, i);
+        hi.words[i] = bignum_limb(a, s + i);
+    }
+    lo.len = hi.len = s;
+    bignum_set_word(&one, 1);
+    bignum_pad(&one, s);
+
+    bignum_mont_mul(&hi, &hi, &ctx->rr, ctx);   // hi * R % n
+    bignum_mont_mul(&lo, &lo, &ctx->rr, ctx);   // lo * R % n
+    bignum_mont_mul(&lo, &lo, &one, ctx);       // lo % n
+    bignum_mod_add(res, &hi, &lo, &ctx->mod);
+    bignum_pad(res, s);
+}
+
+int bignum_mont_init(BignumMont* ctx, const Bignum* mod) {
+    if (bignum_is_zero(mod) || (mod->words[0] & 1) == 0) return -1;
+
+    bignum_copy(&ctx->mod, mod);
+    bignum_trim(&ctx->mod);
+    ctx->limbs = ctx->mod.len;
+
+    // n0inv = -n^-1 mod 2^64 via Newton iteration (each step doubles the correct bits)
+    uint64_t inv = 1;
+    for (int i = 0; i < 6; ++i) {
+        inv *= 2 - mod->words[0] * inv;
+    }
+    ctx->n0inv = (uint64_t)0 - inv;
+
+    // R^2 mod n by doubling 1 a total of 2 * 64 * limbs times
+    bignum_set_word(&ctx->rr, 1);
+    bignum_mod(&ctx->rr, &ctx->rr, &ctx->mod);
+    for (size_t i = 0; i < 2 * 64 * ctx->limbs; ++i) {
+        bignum_mod_add(&ctx->rr, &ctx->rr, &ctx->rr, &ctx->mod);
+    }
+    bignum_pad(&ctx->rr, ctx->limbs);
+    return 0;
+}
+
 
 // --- Public API Implementation ---
 
 void bignum_from_bytes(Bignum* n, const uint8_t* bytes, size_t len) {
-    bignum_zero(n);
+    size_t limbs = (len + 7) / 8;
+    if (limbs > BIGNUM_WORDS) limbs = BIGNUM_WORDS;
+    for (size_t i = 0; i < limbs; ++i) n->words[i] = 0;
+    n->len = limbs;
+
     size_t word_idx = 0;
     size_t shift = 0;
-    for (int i = len - 1; i >= 0; --i) {
-        n->words[word_idx] |= (uint32_t)bytes[i] << shift;
+    for (size_t i = len; i-- > 0;) {
+        n->words[word_idx] |= (uint64_t)bytes[i] << shift;
         shift += 8;
-        if (shift == 32) {
+        if (shift == 64) {
             shift = 0;
             word_idx++;
             if (word_idx >= BIGNUM_WORDS) break;
         }
     }
+    bignum_trim(n);
 }
 
 void bignum_to_bytes(const Bignum* n, uint8_t* bytes, size_t len) {
     size_t word_idx = 0;
     size_t shift = 0;
-    for (int i = len - 1; i >= 0; --i) {
-        bytes[i] = (n->words[word_idx] >> shift) & 0xFF;
+    for (size_t i = len; i-- > 0;) {
+        bytes[i] = (bignum_limb(n, word_idx) >> shift) & 0xFF;
         shift += 8;
-        if (shift == 32) {
+        if (shift == 64) {
             shift = 0;
             word_idx++;
         }
     }
 }
 
-// Modular exponentiation using the right-to-left binary method (square-and-multiply)
+size_t bignum_byte_length(const Bignum* n) {
+    return (bignum_bit_length(n) + 7) / 8;
+}
+
+// Exponents up to this many bits (e.g. 65537) skip the window table entirely
+#define BIGNUM_SMALL_EXP_BITS 32
+// Largest window size; the odd-power table holds 2^(w-1) entries
+#define BIGNUM_MAX_WINDOW 6
+
+// Picks the sliding window size that minimizes multiplies for an exponent length
+static int bignum_window_size(size_t bits) {
+    if (bits > 671) return 6;
+    if (bits > 239) return 5;
+    if (bits > 79) return 4;
+    if (bits > 23) return 3;
+    return 1;
+}
+
+// Modular exponentiation in Montgomery form.
+// Small exponents use plain left-to-right square-and-multiply; larger ones use a
+// sliding window over a precomputed table of odd powers x^1, x^3, ..., x^(2^w - 1).
+void bignum_mod_exp_mont(Bignum* res, const Bignum* base, const Bignum* exp, const BignumMont* ctx) {
+    Bignum x, result, one;
+    size_t bits = bignum_bit_length(exp);
+
+    bignum_set_word(&one, 1);
+    if (bits == 0) {
+        bignum_mod(res, &one, &ctx->mod);
+        return;
+    }
+    bignum_pad(&one, ctx->limbs);
+
+    // Bring the base into Montgomery form: x = base * R % n
+    bignum_mod_mont(&x, base, ctx);
+    bignum_mont_mul(&x, &x, &ctx->rr, ctx);
+
+    if (bits <= BIGNUM_SMALL_EXP_BITS) {
+        // The top bit is always set, so start from x instead of squaring 1
+        bignum_copy(&result, &x);
+        for (size_t i = bits - 1; i-- > 0;) {
+            bignum_mont_mul(&result, &result, &result, ctx);
+            if (bignum_get_bit(exp, i)) {
+                bignum_mont_mul(&result, &result, &x, ctx);
+            }
+        }
+    } else {
+        int w = bignum_window_size(bits);
+        Bignum table[1 << (BIGNUM_MAX_WINDOW - 1)];
+        Bignum x2;
+
+        // table[k] = x^(2k+1)
+        bignum_copy(&table[0], &x);
+        bignum_mont_mul(&x2, &x, &x, ctx);
+        for (int k = 1; k < (1 << (w - 1)); ++k) {
+            bignum_mont_mul(&table[k], &table[k - 1], &x2, ctx);
+        }
+
+        int started = 0;
+        size_t i = bits;
+        while (i > 0) {
+            if (!bignum_get_bit(exp, i - 1)) {
+                bignum_mont_mul(&result, &result, &result, ctx);
+                i--;
+                continue;
+            }
+
+            // Longest window [i-1 .. j] of at most w bits that ends in a set bit
+            size_t j = i > (size_t)w ? i - w : 0;
+            while (!bignum_get_bit(exp, j)) j++;
+
+            unsigned value = 0;
+            for (size_t k = i; k-- > j;) {
+                value = (value << 1) | (unsigned)bignum_get_bit(exp, k);
+            }
+
+            if (started) {
+                for (size_t k = j; k < i; ++k) {
+                    bignum_mont_mul(&result, &result, &result, ctx);
+                }
+                bignum_mont_mul(&result, &result, &table[value >> 1], ctx);
+            } else {
+                bignum_copy(&result, &table[value >> 1]);
+                started = 1;
+            }
+            i = j;
+        }
+    }
+
+    // Leave Montgomery form: result * 1 * R^-1
+    bignum_mont_mul(res, &result, &one, ctx);
+    bignum_trim(res);
+}
+
+// CRT recombination (Garner): res = m2 + q * (qinv * (m1 - m2) % p)
+void bignum_crt_combine(Bignum* res, const Bignum* m1, const Bignum* m2, const Bignum* q,
+                        const Bignum* qinv, const BignumMont* p_ctx) {
+    Bignum t, h;
+
+    // t = (m1 - m2) % p, keeping the value non-negative
+    bignum_mod_mont(&t, m2, p_ctx);
+    bignum_mod_mont(&h, m1, p_ctx);
+    if (bignum_cmp(&h, &t) >= 0) {
+        bignum_sub(&t, &h, &t);
+    } else {
+        bignum_sub(&t, &p_ctx->mod, &t);
+        bignum_add(&t, &t, &h);
+    }
+    bignum_pad(&t, p_ctx->limbs);
+
+    // h = t * qinv % p: the second multiply by R^2 cancels the first R^-1
+    bignum_mod_mont(&h, qinv, p_ctx);
+    bignum_mont_mul(&h, &t, &h, p_ctx);
+    bignum_mont_mul(&h, &h, &p_ctx->rr, p_ctx);
+
+    bignum_mul(&t, &h, q);
+    bignum_add(res, &t, m2);
+    bignum_trim(res);
+}
+
+// Modular exponentiation. Odd moduli (all RSA moduli) go through Montgomery form;
+// anything else falls back to the right-to-left binary method (square-and-multiply).
 void bignum_mod_exp(Bignum* res, const Bignum* base, const Bignum* exp, const Bignum* mod) {
+    BignumMont ctx;
+    if (bignum_mont_init(&ctx, mod) == 0) {
+        bignum_mod_exp_mont(res, base, exp, &ctx);
+        return;
+    }
+
     Bignum current_power, result;
-    bignum_copy(&current_power, base);
-    
+    bignum_mod(&current_power, base, mod);
+
     // Initialize result to 1
-    bignum_zero(&result);
-    result.words[0] = 1;
+    bignum_set_word(&result, 1);
 
     Bignum temp_exp;
     bignum_copy(&temp_exp, exp);
@@ -150,4 +486,4 @@ void bignum_mod_exp(Bignum* res, const Bignum* base, const Bignum* exp, const Bi
         bignum_rshift1(&temp_exp);
     }
     bignum_copy(res, &result);
-}
\ No newline at end of file
+}
@@ -4,14 +4,27 @@
 #include <stdint.h>
 #include <stddef.h>
 
-// A simple bignum structure. For 1024-bit keys, we need 1024/32 = 32 words.
-// We'll use a bit more for safety.
-#define BIGNUM_WORDS 36 
+// A simple bignum structure built from 64-bit limbs (least significant first).
+// Storage is sized for the largest supported key, but every operation only walks
+// the limbs in use, so small values stay cheap.
+#define BIGNUM_MAX_BITS 4096
+// 4096/64 = 64 limbs for the largest modulus. We'll use a bit more for safety.
+#define BIGNUM_WORDS (BIGNUM_MAX_BITS / 64 + 2)
 
 typedef struct {
-    uint32_t words[BIGNUM_WORDS];
+    size_t len;                     // Number of limbs in use; words past len are undefined
+    uint64_t words[BIGNUM_WORDS];
 } Bignum;
 
+// Precomputed Montgomery context for one modulus. Build it once per key
+// with bignum_mont_init() and reuse it for every exponentiation.
+typedef struct {
+    Bignum mod;      // The (odd) modulus n
+    Bignum rr;       // R^2 mod n, where R = 2^(64 * limbs)
+    uint64_t n0inv;  // -n^-1 mod 2^64
+    size_t limbs;    // Number of limbs actually used by n
+} BignumMont;
+
 // --- Public Functions ---
 
 // Creates a bignum from a byte array (big-endian)
@@ -20,7 +33,22 @@ void bignum_from_bytes(Bignum* n, const uint8_t* bytes, size_t len);
 // Converts a bignum to a byte array (big-endian)
 void bignum_to_bytes(const Bignum* n, uint8_t* bytes, size_t len);
 
+// Number of bytes needed to hold the value (0 for zero)
+size_t bignum_byte_length(const Bignum* n);
+
+// Prepares a Montgomery context for the given modulus.
+// Returns 0 on success, -1 if the modulus is zero or even.
+int bignum_mont_init(BignumMont* ctx, const Bignum* mod);
+
+// Modular exponentiation with a precomputed context: res = base^exp % ctx->mod
+void bignum_mod_exp_mont(Bignum* res, const Bignum* base, const Bignum* exp, const BignumMont* ctx);
+
+// Chinese Remainder recombination: given m1 = x % p and m2 = x % q, returns x % (p * q).
+// qinv is q^-1 % p and p_ctx the Montgomery context for p.
+void bignum_crt_combine(Bignum* res, const Bignum* m1, const Bignum* m2, const Bignum* q,
+                        const Bignum* qinv, const BignumMont* p_ctx);
+
 // Modular exponentiation: res = base^exp % mod
 void bignum_mod_exp(Bignum* res, const Bignum* base, const Bignum* exp, const Bignum* mod);
 
-#endif // BIGNUM_H
\ No newline at end of file
+#endif // BIGNUM_H
@@ -1,4 +1,6 @@
 #include "chacha20.h"
+#include "chacha20_simd.h"
+#include "dispatch.h"
 #include <string.h>
 
 // Macro for 32-bit rotation
@@ -25,11 +27,10 @@ static void chacha20_quarter_round(uint32_t *a, uint32_t *b, uint32_t *c, uint32
     *c += *d; *b ^= *c; *b = ROTL32(*b, 7);
 }
 
-void chacha20_block(uint8_t output[64], const uint8_t key[32], uint32_t counter, const uint8_t nonce[12]) {
-    uint32_t state[16];
+// Fills the 16-word initial state for a block counter and nonce
+static void chacha20_init_state(uint32_t state[16], const uint8_t key[32], uint32_t counter, const uint8_t nonce[12]) {
     const uint8_t *constants = (const uint8_t *)"expand 32-byte k";
 
-    // Initialize state
     state[0] = U8TO32_LE(constants + 0);
     state[1] = U8TO32_LE(constants + 4);
     state[2] = U8TO32_LE(constants + 8);
@@ -46,11 +47,10 @@ void chacha20_block(uint8_t output[64], const uint8_t key[32], uint32_t counter,
     state[13] = U8TO32_LE(nonce + 0);
     state[14] = U8TO32_LE(nonce + 4);
     state[15] = U8TO32_LE(nonce + 8);
+}
 
-    uint32_t working_state[16];
-    memcpy(working_state, state, sizeof(state));
-
-    // 20 rounds (10 column rounds and 10 diagonal rounds)
+// The 20 rounds (10 column rounds and 10 diagonal rounds), in place
+static void chacha20_rounds(uint32_t working_state[16]) {
     for (int i = 0; i < 10; ++i) {
         // Column round
         chacha20_quarter_round(&working_state[0], &working_state[4], &working_state[8], &working_state[12]);
@@ -63,6 +63,14 @@ void chacha20_block(uint8_t output[64], const uint8_t key[32], uint32_t counter,
         chacha20_quarter_round(&working_state[2], &working_state[7], &working_state[8], &working_state[13]);
         chacha20_quarter_round(&working_state[3], &working_state[4], &working_state[9], &working_state[14]);
     }
+}
+
+// Scalar block function on a prepared state. This is the reference every
+// SIMD kernel is checked against.
+static void chacha20_core(uint8_t output[64], const uint32_t state[16]) {
+    uint32_t working_state[16];
+    memcpy(working_state, state, sizeof(working_state));
+    chacha20_rounds(working_state);
 
     // Add initial state to the final state and serialize
     for (int i = 0; i < 16; ++i) {
@@ -70,19 +78,201 @@ void chacha20_block(uint8_t output[64], const uint8_t key[32], uint32_t counter,
     }
 }
 
-void chacha20_crypt(uint8_t *out, const uint8_t *in, size_t len, const uint8_t key[32], const uint8_t nonce[12]) {
+void chacha20_block(uint8_t output[64], const uint8_t key[32], uint32_t counter, const uint8_t nonce[12]) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, counter, nonce);
+    chacha20_core(output, state);
+}
+
+void hchacha20(uint8_t subkey[CHACHA20_KEY_SIZE], const uint8_t key[CHACHA20_KEY_SIZE],
+               const uint8_t nonce[HCHACHA20_NONCE_SIZE]) {
+    uint32_t state[16];
+    // The 16 nonce bytes fill words 12-15, where the counter and nonce normally go
+    chacha20_init_state(state, key, U8TO32_LE(nonce), nonce + 4);
+    chacha20_rounds(state);
+    // No feed-forward: the subkey is the first and last rows
+    for (int i = 0; i < 4; ++i) {
+        U32TO8_LE(subkey + 4 * i, state[i]);
+        U32TO8_LE(subkey + 16 + 4 * i, state[12 + i]);
+    }
+    memset(state, 0, sizeof(state));
+}
+
+void xchacha20_derive(uint8_t subkey[CHACHA20_KEY_SIZE], uint8_t nonce[CHACHA20_NONCE_SIZE],
+                      const uint8_t key[CHACHA20_KEY_SIZE], const uint8_t xnonce[XCHACHA20_NONCE_SIZE]) {
+    hchacha20(subkey, key, xnonce);
+    memset(nonce, 0, 4);
+    memcpy(nonce + 4, xnonce + HCHACHA20_NONCE_SIZE, 8);
+}
+
+// XORs len bytes of keystream into in, eight bytes at a time where possible
+static void chacha20_xor(uint8_t *out, const uint8_t *in, const uint8_t *keystream, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, in + i, 8);
+        memcpy(&b, keystream + i, 8);
+        a ^= b;
+        memcpy(out + i, &a, 8);
+    }
+    for (; i < len; ++i) {
+        out[i] = in[i] ^ keystream[i];
+    }
+}
+
+// --- Kernel dispatch ---
+
+typedef void (*chacha20_kernel_fn)(uint8_t *out, const uint8_t *in, const uint32_t state[16]);
+
+typedef struct {
+    const char *name;
+    chacha20_kernel_fn fn;
+    size_t blocks;        // Blocks processed per call
+    int (*supported)(void);
+} Chacha20Impl;
+
+static void chacha20_blocks_scalar(uint8_t *out, const uint8_t *in, const uint32_t state[16]) {
     uint8_t block[64];
-    uint32_t counter = 1;
-    size_t processed = 0;
+    chacha20_core(block, state);
+    chacha20_xor(out, in, block, 64);
+}
+
+static int cpu_always(void) { return 1; }
+#ifdef CHACHA20_HAVE_X86_SIMD
+static int cpu_sse2(void) { __builtin_cpu_init(); return __builtin_cpu_supports("sse2"); }
+static int cpu_avx2(void) { __builtin_cpu_init(); return __builtin_cpu_supports("avx2"); }
+static int cpu_avx512(void) { __builtin_cpu_init(); return __builtin_cpu_supports("avx512f"); }
+#endif
+
+// Candidates, best first. The scalar entry must stay last.
+static const Chacha20Impl chacha20_impls[] = {
+#ifdef CHACHA20_HAVE_X86_SIMD
+    { "avx512", chacha20_blocks_avx512, CHACHA20_AVX512_BLOCKS, cpu_avx512 },
+    { "avx2", chacha20_blocks_avx2, CHACHA20_AVX2_BLOCKS, cpu_avx2 },
+    { "sse2", chacha20_blocks_sse2, CHACHA20_SSE2_BLOCKS, cpu_sse2 },
+#endif
+    { "scalar", chacha20_blocks_scalar, 1, cpu_always },
+};
+#define CHACHA20_IMPL_COUNT (sizeof(chacha20_impls) / sizeof(chacha20_impls[0]))
+
+static int chacha20_active = DISPATCH_UNSET; // Index into chacha20_impls
+
+// Known-answer check of a kernel against the scalar reference. The counter starts
+// just below 2^32 so the per-lane wraparound is covered too.
+static int chacha20_impl_selftest(const Chacha20Impl *impl) {
+    uint8_t key[32], nonce[12], in[64 * 16], expected[64 * 16], actual[64 * 16];
+    uint32_t state[16];
+
+    for (size_t i = 0; i < sizeof(key); ++i) key[i] = (uint8_t)i;
+    for (size_t i = 0; i < sizeof(nonce); ++i) nonce[i] = (uint8_t)(0xA0 + i);
+    for (size_t i = 0; i < sizeof(in); ++i) in[i] = (uint8_t)(i * 7);
+
+    chacha20_init_state(state, key, 0xFFFFFFFEu, nonce);
+    for (size_t b = 0; b < impl->blocks; ++b) {
+        uint32_t block_state[16];
+        memcpy(block_state, state, sizeof(block_state));
+        block_state[12] += (uint32_t)b;
+        chacha20_blocks_scalar(expected + 64 * b, in + 64 * b, block_state);
+    }
+    impl->fn(actual, in, state);
+    return memcmp(expected, actual, 64 * impl->blocks) == 0;
+}
+
+static int chacha20_impl_usable(size_t index) {
+    const Chacha20Impl *impl = &chacha20_impls[index];
+    return impl->supported() && chacha20_impl_selftest(impl);
+}
+
+static const Chacha20Impl *chacha20_get_impl(void) {
+    return &chacha20_impls[dispatch_get(&chacha20_active, CHACHA20_IMPL_COUNT, chacha20_impl_usable)];
+}
 
-    while (processed < len) {
-        chacha20_block(block, key, counter++, nonce);
-        size_t remaining = len - processed;
-        size_t to_xor = (remaining < 64) ? remaining : 64;
+const char *chacha20_impl_name(void) {
+    return chacha20_get_impl()->name;
+}
 
-        for (size_t i = 0; i < to_xor; ++i) {
-            out[processed + i] = in[processed + i] ^ block[i];
+int chacha20_set_impl(const char *name) {
+    for (size_t i = 0; i < CHACHA20_IMPL_COUNT; ++i) {
+        if (strcmp(chacha20_impls[i].name, name) == 0) {
+            if (!chacha20_impl_usable(i)) return -1;
+            dispatch_set(&chacha20_active, i);
+            return 0;
         }
-        processed += to_xor;
     }
-}
\ No newline at end of file
+    return -1;
+}
+
+// --- Streaming API ---
+
+// Loads the context's 64-bit block counter into state words 12 and 13
+static void chacha20_load_counter(Chacha20Ctx *ctx) {
+    ctx->state[12] = (uint32_t)ctx->counter;
+    ctx->state[13] = ctx->nonce0 + (uint32_t)(ctx->counter >> 32);
+}
+
+void chacha20_init(Chacha20Ctx *ctx, const uint8_t key[32], const uint8_t nonce[12], uint64_t counter) {
+    chacha20_init_state(ctx->state, key, 0, nonce);
+    ctx->nonce0 = ctx->state[13];
+    ctx->base_counter = counter;
+    ctx->counter = counter;
+    ctx->ks_pos = 64; // No keystream left over
+}
+
+void chacha20_seek(Chacha20Ctx *ctx, uint64_t offset) {
+    ctx->counter = ctx->base_counter + offset / 64;
+    ctx->ks_pos = 64;
+    if (offset % 64 != 0) {
+        // Land inside a block: generate it and skip the bytes before the offset
+        chacha20_load_counter(ctx);
+        chacha20_core(ctx->keystream, ctx->state);
+        ctx->counter++;
+        ctx->ks_pos = offset % 64;
+    }
+}
+
+void chacha20_update(Chacha20Ctx *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    const Chacha20Impl *impl = chacha20_get_impl();
+    const size_t stride = 64 * impl->blocks;
+
+    // Finish the block left over from the previous call
+    if (ctx->ks_pos < 64 && len > 0) {
+        size_t n = 64 - ctx->ks_pos < len ? 64 - ctx->ks_pos : len;
+        chacha20_xor(out, in, ctx->keystream + ctx->ks_pos, n);
+        ctx->ks_pos += n;
+        out += n;
+        in += n;
+        len -= n;
+    }
+
+    // Whole blocks: as many per call as the kernel handles. SIMD lanes only
+    // carry 32-bit counters, so the blocks around a 2^32 boundary go one by one.
+    while (len >= 64) {
+        size_t blocks = 1;
+        chacha20_load_counter(ctx);
+        if (len >= stride && (uint32_t)ctx->counter <= UINT32_MAX - (impl->blocks - 1)) {
+            impl->fn(out, in, ctx->state);
+            blocks = impl->blocks;
+        } else {
+            chacha20_blocks_scalar(out, in, ctx->state);
+        }
+        ctx->counter += blocks;
+        out += 64 * blocks;
+        in += 64 * blocks;
+        len -= 64 * blocks;
+    }
+
+    // Partial tail: keep the rest of the block for the next call
+    if (len > 0) {
+        chacha20_load_counter(ctx);
+        chacha20_core(ctx->keystream, ctx->state);
+        ctx->counter++;
+        chacha20_xor(out, in, ctx->keystream, len);
+        ctx->ks_pos = len;
+    }
+}
+
+void chacha20_crypt(uint8_t *out, const uint8_t *in, size_t len, const uint8_t key[32], const uint8_t nonce[12]) {
+    Chacha20Ctx ctx;
+    chacha20_init(&ctx, key, nonce, 1);
+    chacha20_update(&ctx, out, in, len);
+}
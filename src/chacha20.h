@@ -6,12 +6,60 @@
 
 #define CHACHA20_KEY_SIZE 32 // 256 bits
 #define CHACHA20_NONCE_SIZE 12 // 96 bits
+#define CHACHA20_BLOCK_SIZE 64
+#define HCHACHA20_NONCE_SIZE 16
+#define XCHACHA20_NONCE_SIZE 24 // 192 bits
+
+// Streaming state. The block counter is 64 bits wide: its low word is state
+// word 12 as in RFC 8439, and its high word is added to the first nonce word,
+// so the first 2^32 blocks (256 GB) match the RFC exactly.
+typedef struct {
+    uint32_t state[16];
+    uint32_t nonce0;        // First nonce word, before the counter's high word is added
+    uint64_t base_counter;  // Counter at stream offset 0
+    uint64_t counter;       // Counter of the next block to generate
+    uint8_t keystream[64];  // Current partial block
+    size_t ks_pos;          // Bytes of keystream already used (64 when none is left)
+} Chacha20Ctx;
 
 // The core function. Generates a 64-byte keystream block.
 void chacha20_block(uint8_t output[64], const uint8_t key[32], uint32_t counter, const uint8_t nonce[12]);
 
+// HChaCha20: the ChaCha20 rounds over key and a 16-byte nonce, without the
+// final addition, giving a 32-byte subkey (draft-irtf-cfrg-xchacha).
+void hchacha20(uint8_t subkey[CHACHA20_KEY_SIZE], const uint8_t key[CHACHA20_KEY_SIZE],
+               const uint8_t nonce[HCHACHA20_NONCE_SIZE]);
+
+// XChaCha20: ChaCha20 with a 24-byte nonce, long enough to be picked at random
+// for every message. The subkey is HChaCha20 of key and the first 16 nonce
+// bytes; the ChaCha20 nonce is 4 zero bytes and the last 8. Encrypting under
+// the returned subkey and nonce is XChaCha20 under key and xnonce.
+void xchacha20_derive(uint8_t subkey[CHACHA20_KEY_SIZE], uint8_t nonce[CHACHA20_NONCE_SIZE],
+                      const uint8_t key[CHACHA20_KEY_SIZE], const uint8_t xnonce[XCHACHA20_NONCE_SIZE]);
+
+// Starts a stream at the given block counter (1 for the file format).
+void chacha20_init(Chacha20Ctx *ctx, const uint8_t key[32], const uint8_t nonce[12], uint64_t counter);
+
+// Encrypts or decrypts the next len bytes of the stream. Calls can use any
+// lengths; leftover keystream is carried over to the next call.
+void chacha20_update(Chacha20Ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+// Moves to a byte offset from the start of the stream, so a range can be
+// processed without generating the keystream before it.
+void chacha20_seek(Chacha20Ctx *ctx, uint64_t offset);
+
 // Encrypts or decrypts data using the ChaCha20 stream cipher.
 // The operation is the same for both encryption and decryption.
+// One-shot form of the streaming API, starting at block counter 1.
 void chacha20_crypt(uint8_t *out, const uint8_t *in, size_t len, const uint8_t key[32], const uint8_t nonce[12]);
 
+// Name of the keystream kernel in use: "avx512", "avx2", "sse2" or "scalar".
+// The best kernel the CPU supports is picked on first use, after checking it
+// against the scalar reference.
+const char *chacha20_impl_name(void);
+
+// Forces a specific kernel by name (e.g. "scalar" for comparisons).
+// Returns 0 on success, -1 if the kernel is unknown or unsupported here.
+int chacha20_set_impl(const char *name);
+
 #endif // CHACHA20_H
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "chacha20_poly1305.h"
+#include <string.h>
+
+// Bytes encrypted before they are authenticated: small enough to stay in L1,
+// large enough for whole SIMD strides of both kernels
+#define FUSE_SIZE 4096
+
+void chacha20_poly1305_init(Chacha20Poly1305Ctx *ctx, const uint8_t key[CHACHA20_KEY_SIZE],
+                            const uint8_t nonce[CHACHA20_NONCE_SIZE]) {
+    uint8_t block0[64];
+    chacha20_block(block0, key, 0, nonce);
+    poly1305_init(&ctx->mac, block0);
+    memset(block0, 0, sizeof(block0));
+    chacha20_init(&ctx->cipher, key, nonce, 1);
+    ctx->aad_len = 0;
+    ctx->data_len = 0;
+}
+
+void chacha20_poly1305_aad(Chacha20Poly1305Ctx *ctx, const uint8_t *aad, size_t len) {
+    poly1305_update(&ctx->mac, aad, len);
+    ctx->aad_len += len;
+}
+
+// The AAD is zero-padded to a whole block before the first ciphertext byte
+static void chacha20_poly1305_start_data(Chacha20Poly1305Ctx *ctx) {
+    if (ctx->data_len == 0) poly1305_pad16(&ctx->mac);
+}
+
+void chacha20_poly1305_encrypt(Chacha20Poly1305Ctx *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    chacha20_poly1305_start_data(ctx);
+    for (size_t done = 0; done < len; done += FUSE_SIZE) {
+        size_t n = len - done < FUSE_SIZE ? len - done : FUSE_SIZE;
+        chacha20_update(&ctx->cipher, out + done, in + done, n);
+        poly1305_update(&ctx->mac, out + done, n);
+    }
+    ctx->data_len += len;
+}
+
+void chacha20_poly1305_decrypt(Chacha20Poly1305Ctx *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    chacha20_poly1305_start_data(ctx);
+    for (size_t done = 0; done < len; done += FUSE_SIZE) {
+        size_t n = len - done < FUSE_SIZE ? len - done : FUSE_SIZE;
+        // MAC the ciphertext first: out may overwrite it
+        poly1305_update(&ctx->mac, in + done, n);
+        chacha20_update(&ctx->cipher, out + done, in + done, n);
+    }
+    ctx->data_len += len;
+}
+
+void chacha20_poly1305_final(Chacha20Poly1305Ctx *ctx, uint8_t tag[CHACHA20_POLY1305_TAG_SIZE]) {
+    uint8_t lengths[16];
+    for (int i = 0; i < 8; ++i) {
+        lengths[i] = (uint8_t)(ctx->aad_len >> (8 * i));
+        lengths[8 + i] = (uint8_t)(ctx->data_len >> (8 * i));
+    }
+    poly1305_pad16(&ctx->mac);
+    poly1305_update(&ctx->mac, lengths, sizeof(lengths));
+    poly1305_final(&ctx->mac, tag);
+    memset(ctx, 0, sizeof(*ctx));
+}
@@ -0,0 +1,38 @@
+#ifndef CHACHA20_POLY1305_H
+#define CHACHA20_POLY1305_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "chacha20.h"
+#include "poly1305.h"
+
+#define CHACHA20_POLY1305_TAG_SIZE POLY1305_TAG_SIZE
+
+// Streaming ChaCha20-Poly1305 AEAD (RFC 8439). The Poly1305 key is the first
+// half of keystream block 0 and the data is encrypted from block 1, so the
+// ciphertext equals plain ChaCha20 under the same key and nonce. Encryption
+// and MAC are fused: each step encrypts a few KB and authenticates them while
+// they are still in L1, so the data makes one trip through memory.
+typedef struct {
+    Chacha20Ctx cipher;
+    Poly1305Ctx mac;
+    uint64_t aad_len;
+    uint64_t data_len;
+} Chacha20Poly1305Ctx;
+
+void chacha20_poly1305_init(Chacha20Poly1305Ctx *ctx, const uint8_t key[CHACHA20_KEY_SIZE],
+                            const uint8_t nonce[CHACHA20_NONCE_SIZE]);
+
+// Authenticates associated data. All of it must come before the first
+// encrypt/decrypt call.
+void chacha20_poly1305_aad(Chacha20Poly1305Ctx *ctx, const uint8_t *aad, size_t len);
+
+// Encrypts or decrypts the next len bytes. out may equal in.
+void chacha20_poly1305_encrypt(Chacha20Poly1305Ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+void chacha20_poly1305_decrypt(Chacha20Poly1305Ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+// Writes the tag over everything processed and wipes the state. After
+// decrypting, compare it with the received tag using poly1305_verify().
+void chacha20_poly1305_final(Chacha20Poly1305Ctx *ctx, uint8_t tag[CHACHA20_POLY1305_TAG_SIZE]);
+
+#endif // CHACHA20_POLY1305_H
@@ -0,0 +1,178 @@
+#include "chacha20_simd.h"
+
+#ifdef CHACHA20_HAVE_X86_SIMD
+#include <immintrin.h>
+
+// Each kernel keeps word i of every block in one vector (x[i], one block per lane),
+// runs the 20 rounds lane-parallel, then transposes back to block order so the
+// keystream can be XORed into the input a whole vector at a time.
+
+// One ChaCha20 quarter round on vectors, parameterized by the ISA's operations
+#define CHACHA_QR(ADD, XOR, R16, R12, R8, R7, a, b, c, d) \
+    a = ADD(a, b); d = XOR(d, a); d = R16(d);             \
+    c = ADD(c, d); b = XOR(b, c); b = R12(b);             \
+    a = ADD(a, b); d = XOR(d, a); d = R8(d);              \
+    c = ADD(c, d); b = XOR(b, c); b = R7(b);
+
+// A column round followed by a diagonal round
+#define CHACHA_DOUBLE_ROUND(ADD, XOR, R16, R12, R8, R7, x)                    \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[0], x[4], x[8], x[12])            \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[1], x[5], x[9], x[13])            \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[2], x[6], x[10], x[14])           \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[3], x[7], x[11], x[15])           \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[0], x[5], x[10], x[15])           \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[1], x[6], x[11], x[12])           \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[2], x[7], x[8], x[13])            \
+    CHACHA_QR(ADD, XOR, R16, R12, R8, R7, x[3], x[4], x[9], x[14])
+
+// Transposes a 4x4 matrix of 32-bit words within each 128-bit lane
+#define TRANSPOSE4(UNLO32, UNHI32, UNLO64, UNHI64, a, b, c, d) do { \
+        __typeof__(a) t0 = UNLO32(a, b), t1 = UNLO32(c, d);          \
+        __typeof__(a) t2 = UNHI32(a, b), t3 = UNHI32(c, d);          \
+        a = UNLO64(t0, t1); b = UNHI64(t0, t1);                      \
+        c = UNLO64(t2, t3); d = UNHI64(t2, t3);                      \
+    } while (0)
+
+// --- SSE2: 4 blocks ---
+
+#define SSE2_ROTL(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define SSE2_R16(v) SSE2_ROTL(v, 16)
+#define SSE2_R12(v) SSE2_ROTL(v, 12)
+#define SSE2_R8(v) SSE2_ROTL(v, 8)
+#define SSE2_R7(v) SSE2_ROTL(v, 7)
+
+__attribute__((target("sse2")))
+void chacha20_blocks_sse2(uint8_t* out, const uint8_t* in, const uint32_t state[16]) {
+    __m128i x[16], orig[16];
+    for (int i = 0; i < 16; ++i) {
+        orig[i] = _mm_set1_epi32((int)state[i]);
+    }
+    orig[12] = _mm_add_epi32(orig[12], _mm_setr_epi32(0, 1, 2, 3));
+    for (int i = 0; i < 16; ++i) x[i] = orig[i];
+
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_DOUBLE_ROUND(_mm_add_epi32, _mm_xor_si128, SSE2_R16, SSE2_R12, SSE2_R8, SSE2_R7, x)
+    }
+
+    for (int g = 0; g < 4; ++g) {
+        __m128i a = _mm_add_epi32(x[4 * g + 0], orig[4 * g + 0]);
+        __m128i b = _mm_add_epi32(x[4 * g + 1], orig[4 * g + 1]);
+        __m128i c = _mm_add_epi32(x[4 * g + 2], orig[4 * g + 2]);
+        __m128i d = _mm_add_epi32(x[4 * g + 3], orig[4 * g + 3]);
+        TRANSPOSE4(_mm_unpacklo_epi32, _mm_unpackhi_epi32, _mm_unpacklo_epi64, _mm_unpackhi_epi64, a, b, c, d);
+
+        // After the transpose, vector j holds words 4g..4g+3 of block j
+        __m128i ks[4] = { a, b, c, d };
+        for (int j = 0; j < 4; ++j) {
+            size_t off = 64 * j + 16 * g;
+            __m128i v = _mm_loadu_si128((const __m128i*)(in + off));
+            _mm_storeu_si128((__m128i*)(out + off), _mm_xor_si128(v, ks[j]));
+        }
+    }
+}
+
+// --- AVX2: 8 blocks ---
+
+#define AVX2_ROTL(v, n) _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+#define AVX2_R16(v) _mm256_shuffle_epi8(v, rot16)
+#define AVX2_R12(v) AVX2_ROTL(v, 12)
+#define AVX2_R8(v) _mm256_shuffle_epi8(v, rot8)
+#define AVX2_R7(v) AVX2_ROTL(v, 7)
+
+__attribute__((target("avx2")))
+void chacha20_blocks_avx2(uint8_t* out, const uint8_t* in, const uint32_t state[16]) {
+    // Byte shuffles for the 16- and 8-bit rotations
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                          3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    __m256i x[16], orig[16];
+    for (int i = 0; i < 16; ++i) {
+        orig[i] = _mm256_set1_epi32((int)state[i]);
+    }
+    orig[12] = _mm256_add_epi32(orig[12], _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    for (int i = 0; i < 16; ++i) x[i] = orig[i];
+
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_DOUBLE_ROUND(_mm256_add_epi32, _mm256_xor_si256, AVX2_R16, AVX2_R12, AVX2_R8, AVX2_R7, x)
+    }
+
+    // ks[g][j]: words 4g..4g+3 of block j (low 128 bits) and block j+4 (high 128 bits)
+    __m256i ks[4][4];
+    for (int g = 0; g < 4; ++g) {
+        __m256i a = _mm256_add_epi32(x[4 * g + 0], orig[4 * g + 0]);
+        __m256i b = _mm256_add_epi32(x[4 * g + 1], orig[4 * g + 1]);
+        __m256i c = _mm256_add_epi32(x[4 * g + 2], orig[4 * g + 2]);
+        __m256i d = _mm256_add_epi32(x[4 * g + 3], orig[4 * g + 3]);
+        TRANSPOSE4(_mm256_unpacklo_epi32, _mm256_unpackhi_epi32, _mm256_unpacklo_epi64, _mm256_unpackhi_epi64,
+                   a, b, c, d);
+        ks[g][0] = a; ks[g][1] = b; ks[g][2] = c; ks[g][3] = d;
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        __m256i lo01 = _mm256_permute2x128_si256(ks[0][j], ks[1][j], 0x20); // block j, bytes 0..31
+        __m256i lo23 = _mm256_permute2x128_si256(ks[2][j], ks[3][j], 0x20); // block j, bytes 32..63
+        __m256i hi01 = _mm256_permute2x128_si256(ks[0][j], ks[1][j], 0x31); // block j+4, bytes 0..31
+        __m256i hi23 = _mm256_permute2x128_si256(ks[2][j], ks[3][j], 0x31); // block j+4, bytes 32..63
+        __m256i blocks[4] = { lo01, lo23, hi01, hi23 };
+        size_t offs[4] = { 64 * j, 64 * j + 32, 64 * (j + 4), 64 * (j + 4) + 32 };
+        for (int k = 0; k < 4; ++k) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(in + offs[k]));
+            _mm256_storeu_si256((__m256i*)(out + offs[k]), _mm256_xor_si256(v, blocks[k]));
+        }
+    }
+}
+
+// --- AVX-512: 16 blocks ---
+
+#define AVX512_R16(v) _mm512_rol_epi32(v, 16)
+#define AVX512_R12(v) _mm512_rol_epi32(v, 12)
+#define AVX512_R8(v) _mm512_rol_epi32(v, 8)
+#define AVX512_R7(v) _mm512_rol_epi32(v, 7)
+
+__attribute__((target("avx512f")))
+void chacha20_blocks_avx512(uint8_t* out, const uint8_t* in, const uint32_t state[16]) {
+    __m512i x[16], orig[16];
+    for (int i = 0; i < 16; ++i) {
+        orig[i] = _mm512_set1_epi32((int)state[i]);
+    }
+    orig[12] = _mm512_add_epi32(orig[12], _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    for (int i = 0; i < 16; ++i) x[i] = orig[i];
+
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_DOUBLE_ROUND(_mm512_add_epi32, _mm512_xor_si512, AVX512_R16, AVX512_R12, AVX512_R8, AVX512_R7, x)
+    }
+
+    // ks[g][j]: 128-bit lane L holds words 4g..4g+3 of block j + 4L
+    __m512i ks[4][4];
+    for (int g = 0; g < 4; ++g) {
+        __m512i a = _mm512_add_epi32(x[4 * g + 0], orig[4 * g + 0]);
+        __m512i b = _mm512_add_epi32(x[4 * g + 1], orig[4 * g + 1]);
+        __m512i c = _mm512_add_epi32(x[4 * g + 2], orig[4 * g + 2]);
+        __m512i d = _mm512_add_epi32(x[4 * g + 3], orig[4 * g + 3]);
+        TRANSPOSE4(_mm512_unpacklo_epi32, _mm512_unpackhi_epi32, _mm512_unpacklo_epi64, _mm512_unpackhi_epi64,
+                   a, b, c, d);
+        ks[g][0] = a; ks[g][1] = b; ks[g][2] = c; ks[g][3] = d;
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        // Transpose the 128-bit lanes so each vector holds one whole block
+        __m512i a = _mm512_shuffle_i32x4(ks[0][j], ks[1][j], 0x44);
+        __m512i b = _mm512_shuffle_i32x4(ks[0][j], ks[1][j], 0xEE);
+        __m512i c = _mm512_shuffle_i32x4(ks[2][j], ks[3][j], 0x44);
+        __m512i d = _mm512_shuffle_i32x4(ks[2][j], ks[3][j], 0xEE);
+        __m512i blocks[4] = {
+            _mm512_shuffle_i32x4(a, c, 0x88), // block j
+            _mm512_shuffle_i32x4(a, c, 0xDD), // block j + 4
+            _mm512_shuffle_i32x4(b, d, 0x88), // block j + 8
+            _mm512_shuffle_i32x4(b, d, 0xDD), // block j + 12
+        };
+        for (int k = 0; k < 4; ++k) {
+            size_t off = 64 * (j + 4 * k);
+            __m512i v = _mm512_loadu_si512((const void*)(in + off));
+            _mm512_storeu_si512((void*)(out + off), _mm512_xor_si512(v, blocks[k]));
+        }
+    }
+}
+
+#endif // CHACHA20_HAVE_X86_SIMD
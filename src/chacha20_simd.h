@@ -0,0 +1,24 @@
+#ifndef CHACHA20_SIMD_H
+#define CHACHA20_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Internal multi-block ChaCha20 kernels used by chacha20.c.
+// Each kernel XORs CHACHA20_<ISA>_BLOCKS consecutive 64-byte keystream blocks
+// into in, starting at the block counter in state[12], and writes them to out.
+// The state itself is not modified. Counters wrap at 32 bits in every lane.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHACHA20_HAVE_X86_SIMD 1
+
+#define CHACHA20_SSE2_BLOCKS 4
+#define CHACHA20_AVX2_BLOCKS 8
+#define CHACHA20_AVX512_BLOCKS 16
+
+void chacha20_blocks_sse2(uint8_t* out, const uint8_t* in, const uint32_t state[16]);
+void chacha20_blocks_avx2(uint8_t* out, const uint8_t* in, const uint32_t state[16]);
+void chacha20_blocks_avx512(uint8_t* out, const uint8_t* in, const uint32_t state[16]);
+#endif
+
+#endif // CHACHA20_SIMD_H
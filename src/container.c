@@ -0,0 +1,259 @@
+#include "container.h"
+#include "chacha20_poly1305.h"
+#include "poly1305.h"
+#include "tea.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CONTAINER_MAGIC "CCRC"
+#define CONTAINER_INDEX_MAGIC "CIDX"
+#define CONTAINER_VERSION 1
+#define CONTAINER_FLAG_INDEX 0x01
+#define CONTAINER_FINAL 0x80000000u
+#define CONTAINER_AAD_SIZE (CONTAINER_HEADER_SIZE + 8 + 4)
+
+static uint32_t load32_be(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void store32_be(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (24 - 8 * i));
+}
+
+static uint64_t load64_be(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+    return v;
+}
+
+static void store64_be(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (56 - 8 * i));
+}
+
+static const char* cipher_name(int cipher) {
+    return cipher == CONTAINER_CHACHA20 ? "chacha20" : cipher == CONTAINER_TEA ? "tea" : "an unknown cipher";
+}
+
+void container_init(Container* c, ContainerCipher cipher, const uint8_t* key, uint32_t record_size,
+                    int has_index, const uint8_t nonce[CONTAINER_NONCE_SIZE]) {
+    c->cipher = cipher;
+    c->record_size = record_size;
+    c->has_index = has_index;
+    c->key = key;
+
+    uint8_t* h = c->header;
+    memset(h, 0, CONTAINER_HEADER_SIZE);
+    memcpy(h, CONTAINER_MAGIC, 4);
+    h[4] = CONTAINER_VERSION;
+    h[5] = (uint8_t)cipher;
+    h[6] = has_index ? CONTAINER_FLAG_INDEX : 0;
+    store32_be(h + 8, record_size);
+    memcpy(h + 12, nonce, cipher == CONTAINER_TEA ? TEA_BLOCK_SIZE : CONTAINER_NONCE_SIZE);
+}
+
+int container_parse(Container* c, ContainerCipher cipher, const uint8_t* key,
+                    const uint8_t header[CONTAINER_HEADER_SIZE]) {
+    if (memcmp(header, CONTAINER_MAGIC, 4) != 0) {
+        fprintf(stderr, "Error: Input is not a record container.\n");
+        return -1;
+    }
+    if (header[4] != CONTAINER_VERSION) {
+        fprintf(stderr, "Error: Unsupported container version %d.\n", header[4]);
+        return -1;
+    }
+    if (header[5] != cipher) {
+        fprintf(stderr, "Error: Container was written with %s, not %s.\n", cipher_name(header[5]), cipher_name(cipher));
+        return -1;
+    }
+    uint32_t record_size = load32_be(header + 8);
+    int reserved = header[7];
+    for (int i = 24; i < CONTAINER_HEADER_SIZE; ++i) reserved |= header[i];
+    if (cipher == CONTAINER_TEA) {
+        for (int i = 12 + TEA_BLOCK_SIZE; i < 24; ++i) reserved |= header[i];
+    }
+    if ((header[6] & ~CONTAINER_FLAG_INDEX) || reserved || record_size == 0 || record_size % 64 != 0 ||
+        record_size > CONTAINER_MAX_RECORD_SIZE) {
+        fprintf(stderr, "Error: Invalid container header.\n");
+        return -1;
+    }
+
+    c->cipher = cipher;
+    c->record_size = record_size;
+    c->has_index = header[6] & CONTAINER_FLAG_INDEX;
+    c->key = key;
+    memcpy(c->header, header, CONTAINER_HEADER_SIZE);
+    return 0;
+}
+
+uint64_t container_record_offset(const Container* c, uint64_t index) {
+    return CONTAINER_HEADER_SIZE + index * ((uint64_t)c->record_size + CONTAINER_RECORD_OVERHEAD);
+}
+
+static size_t ciphertext_size(const Container* c, size_t len, int final) {
+    // PKCS#7 always adds 1..8 bytes
+    return c->cipher == CONTAINER_TEA && final ? len + TEA_BLOCK_SIZE - len % TEA_BLOCK_SIZE : len;
+}
+
+size_t container_sealed_size(const Container* c, size_t len, int final) {
+    return ciphertext_size(c, len, final) + CONTAINER_RECORD_OVERHEAD;
+}
+
+// Associated data of a record: the header, its index and its length word
+static void record_aad(const Container* c, uint64_t index, const uint8_t* length_word, uint8_t aad[CONTAINER_AAD_SIZE]) {
+    memcpy(aad, c->header, CONTAINER_HEADER_SIZE);
+    store64_be(aad + CONTAINER_HEADER_SIZE, index);
+    memcpy(aad + CONTAINER_HEADER_SIZE + 8, length_word, 4);
+}
+
+static void record_nonce(const Container* c, uint64_t index, uint8_t nonce[CHACHA20_NONCE_SIZE]) {
+    memcpy(nonce, c->header + 12, CHACHA20_NONCE_SIZE);
+    for (int i = 0; i < 8; ++i) nonce[4 + i] ^= (uint8_t)(index >> (56 - 8 * i));
+}
+
+// CBC IV and Poly1305 key of a TEA record: TEA-CTR keystream blocks 8i..8i+4
+static void tea_record_keys(const Container* c, uint64_t index, uint8_t iv[TEA_BLOCK_SIZE], uint8_t mac_key[POLY1305_KEY_SIZE]) {
+    uint8_t material[TEA_BLOCK_SIZE + POLY1305_KEY_SIZE] = { 0 };
+    tea_ctr_crypt(material, material, sizeof(material), c->key, load64_be(c->header + 12), index * 64);
+    memcpy(iv, material, TEA_BLOCK_SIZE);
+    memcpy(mac_key, material + TEA_BLOCK_SIZE, POLY1305_KEY_SIZE);
+    memset(material, 0, sizeof(material));
+}
+
+// The RFC 8439 tag layout: AAD and ciphertext, each padded to 16 bytes, then both lengths
+static void record_mac(const uint8_t mac_key[POLY1305_KEY_SIZE], const uint8_t* aad, const uint8_t* ct, size_t ct_len,
+                       uint8_t tag[POLY1305_TAG_SIZE]) {
+    Poly1305Ctx mac;
+    uint8_t lengths[16];
+    for (int i = 0; i < 8; ++i) {
+        lengths[i] = (uint8_t)((uint64_t)CONTAINER_AAD_SIZE >> (8 * i));
+        lengths[8 + i] = (uint8_t)((uint64_t)ct_len >> (8 * i));
+    }
+    poly1305_init(&mac, mac_key);
+    poly1305_update(&mac, aad, CONTAINER_AAD_SIZE);
+    poly1305_pad16(&mac);
+    poly1305_update(&mac, ct, ct_len);
+    poly1305_pad16(&mac);
+    poly1305_update(&mac, lengths, sizeof(lengths));
+    poly1305_final(&mac, tag);
+}
+
+// Poly1305 key of a record
+static void record_mac_key(const Container* c, uint64_t index, uint8_t mac_key[POLY1305_KEY_SIZE], uint8_t iv[TEA_BLOCK_SIZE]) {
+    if (c->cipher == CONTAINER_CHACHA20) {
+        uint8_t nonce[CHACHA20_NONCE_SIZE], block0[64];
+        record_nonce(c, index, nonce);
+        chacha20_block(block0, c->key, 0, nonce);
+        memcpy(mac_key, block0, POLY1305_KEY_SIZE);
+        memset(block0, 0, sizeof(block0));
+    } else {
+        tea_record_keys(c, index, iv, mac_key);
+    }
+}
+
+size_t container_seal(const Container* c, uint64_t index, int final, uint8_t* out, const uint8_t* in, size_t len) {
+    size_t ct_len = ciphertext_size(c, len, final);
+    uint8_t* ct = out + 4;
+    uint8_t aad[CONTAINER_AAD_SIZE];
+    store32_be(out, (uint32_t)ct_len | (final ? CONTAINER_FINAL : 0));
+    record_aad(c, index, out, aad);
+
+    if (c->cipher == CONTAINER_CHACHA20) {
+        uint8_t nonce[CHACHA20_NONCE_SIZE];
+        Chacha20Poly1305Ctx aead;
+        record_nonce(c, index, nonce);
+        chacha20_poly1305_init(&aead, c->key, nonce);
+        chacha20_poly1305_aad(&aead, aad, sizeof(aad));
+        chacha20_poly1305_encrypt(&aead, ct, in, len);
+        chacha20_poly1305_final(&aead, ct + ct_len);
+    } else {
+        uint8_t iv[TEA_BLOCK_SIZE], mac_key[POLY1305_KEY_SIZE];
+        tea_record_keys(c, index, iv, mac_key);
+        if (ct != in) memmove(ct, in, len);
+        memset(ct + len, (int)(ct_len - len), ct_len - len);
+        tea_cbc_encrypt(ct, ct_len, c->key, iv);
+        record_mac(mac_key, aad, ct, ct_len, ct + ct_len);
+        memset(mac_key, 0, sizeof(mac_key));
+    }
+    return ct_len + CONTAINER_RECORD_OVERHEAD;
+}
+
+size_t container_record_size(const Container* c, const uint8_t* in, size_t avail, int* final) {
+    if (avail < 4) return 0;
+    uint32_t word = load32_be(in);
+    size_t ct_len = word & ~CONTAINER_FINAL;
+    *final = (word & CONTAINER_FINAL) != 0;
+    if (!*final) {
+        if (ct_len != c->record_size) return 0;
+    } else if (c->cipher == CONTAINER_TEA) {
+        if (ct_len == 0 || ct_len % TEA_BLOCK_SIZE != 0 || ct_len > (size_t)c->record_size + TEA_BLOCK_SIZE) return 0;
+    } else if (ct_len > c->record_size) {
+        return 0;
+    }
+    size_t size = ct_len + CONTAINER_RECORD_OVERHEAD;
+    return size <= avail ? size : 0;
+}
+
+int container_verify(const Container* c, uint64_t index, const uint8_t* in, size_t record_len) {
+    uint8_t aad[CONTAINER_AAD_SIZE], mac_key[POLY1305_KEY_SIZE], iv[TEA_BLOCK_SIZE], tag[POLY1305_TAG_SIZE];
+    size_t ct_len = record_len - CONTAINER_RECORD_OVERHEAD;
+    record_aad(c, index, in, aad);
+    record_mac_key(c, index, mac_key, iv);
+    record_mac(mac_key, aad, in + 4, ct_len, tag);
+    memset(mac_key, 0, sizeof(mac_key));
+    return poly1305_verify(tag, in + 4 + ct_len);
+}
+
+int container_open(const Container* c, uint64_t index, uint8_t* out, size_t* out_len,
+                   const uint8_t* in, size_t record_len) {
+    const uint8_t* ct = in + 4;
+    size_t ct_len = record_len - CONTAINER_RECORD_OVERHEAD;
+    int final = (in[0] & 0x80) != 0;
+    uint8_t aad[CONTAINER_AAD_SIZE], tag[POLY1305_TAG_SIZE], received[POLY1305_TAG_SIZE];
+    record_aad(c, index, in, aad);
+    // The plaintext may overwrite the ciphertext, but never the tag behind it
+    memcpy(received, ct + ct_len, POLY1305_TAG_SIZE);
+
+    if (c->cipher == CONTAINER_CHACHA20) {
+        uint8_t nonce[CHACHA20_NONCE_SIZE];
+        Chacha20Poly1305Ctx aead;
+        record_nonce(c, index, nonce);
+        chacha20_poly1305_init(&aead, c->key, nonce);
+        chacha20_poly1305_aad(&aead, aad, sizeof(aad));
+        chacha20_poly1305_decrypt(&aead, out, ct, ct_len);
+        chacha20_poly1305_final(&aead, tag);
+        if (poly1305_verify(tag, received) != 0) return -1;
+        *out_len = ct_len;
+        return 0;
+    }
+
+    // TEA: encrypt-then-MAC, so the tag is checked before anything is decrypted
+    uint8_t iv[TEA_BLOCK_SIZE], mac_key[POLY1305_KEY_SIZE];
+    tea_record_keys(c, index, iv, mac_key);
+    record_mac(mac_key, aad, ct, ct_len, tag);
+    memset(mac_key, 0, sizeof(mac_key));
+    if (poly1305_verify(tag, received) != 0) return -1;
+    if (out != ct) memmove(out, ct, ct_len);
+    tea_cbc_decrypt(out, ct_len, c->key, iv);
+    size_t padding = final ? tea_cbc_padding_length(out + ct_len - TEA_BLOCK_SIZE) : 0;
+    if (final && padding == 0) return -1;
+    *out_len = ct_len - padding;
+    return 0;
+}
+
+void container_encode_index(uint8_t out[CONTAINER_INDEX_SIZE], uint64_t records, uint64_t plain_len) {
+    memset(out, 0, CONTAINER_INDEX_SIZE);
+    memcpy(out, CONTAINER_INDEX_MAGIC, 4);
+    store64_be(out + 8, records);
+    store64_be(out + 16, plain_len);
+}
+
+int container_parse_index(const uint8_t in[CONTAINER_INDEX_SIZE], uint64_t* records, uint64_t* plain_len) {
+    int reserved = 0;
+    for (int i = 4; i < 8; ++i) reserved |= in[i];
+    for (int i = 24; i < CONTAINER_INDEX_SIZE; ++i) reserved |= in[i];
+    if (memcmp(in, CONTAINER_INDEX_MAGIC, 4) != 0 || reserved) return -1;
+    *records = load64_be(in + 8);
+    *plain_len = load64_be(in + 16);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Record container (--container). The file is a header followed by records of
+// a fixed plaintext size, each sealed on its own, and an optional index:
+//
+//   header   magic "CCRC", version 1, cipher, flags, reserved byte,
+//            record size (4 bytes, big-endian), nonce (12 bytes), 8 zero bytes
+//   record   length word (4 bytes, big-endian: ciphertext length, top bit set
+//            on the final record), ciphertext, 16-byte Poly1305 tag
+//   index    magic "CIDX", 4 zero bytes, record count and plaintext length
+//            (8 bytes each, big-endian), 8 zero bytes
+//
+// Every record but the last holds exactly record_size bytes, so record i starts
+// at CONTAINER_HEADER_SIZE + i * (record_size + CONTAINER_RECORD_OVERHEAD) and
+// any record can be found, checked and decrypted without touching the others.
+// Each record gets its own nonce derived from the header nonce and its index,
+// and its tag also covers the header, its index and its length word, so
+// records can't be reordered, moved between files, or cut off at the end.
+// The index holds nothing the records don't already determine; readers check
+// it against them, and use it to size the plaintext without a scan.
+//
+//   chacha20  ChaCha20-Poly1305 (RFC 8439) per record; the nonce for record i
+//             is the header nonce with i XORed into its last 8 bytes.
+//   tea       TEA-CBC per record, PKCS#7 padding on the final record only.
+//             The record's CBC IV and Poly1305 key are 40 bytes of TEA-CTR
+//             keystream under the header IV at block 8 * i, and the tag is
+//             computed over the ciphertext as in RFC 8439.
+
+#define CONTAINER_HEADER_SIZE 32
+#define CONTAINER_INDEX_SIZE 32
+#define CONTAINER_RECORD_OVERHEAD 20 // Length word and tag
+#define CONTAINER_MAX_PADDING 8      // TEA pads the final record by up to a block
+#define CONTAINER_DEFAULT_RECORD_SIZE (1024 * 1024)
+#define CONTAINER_MAX_RECORD_SIZE (256 * 1024 * 1024)
+#define CONTAINER_NONCE_SIZE 12
+
+typedef enum {
+    CONTAINER_CHACHA20 = 1,
+    CONTAINER_TEA = 2,
+} ContainerCipher;
+
+typedef struct {
+    ContainerCipher cipher;
+    uint32_t record_size;   // Plaintext bytes per record, a multiple of 64
+    int has_index;
+    const uint8_t* key;     // 32-byte ChaCha20 or 16-byte TEA key, not copied
+    uint8_t header[CONTAINER_HEADER_SIZE];
+} Container;
+
+// Sets up a new container and encodes its header. For TEA only the first 8
+// bytes of the nonce are used (the IV); the rest of the field is zero.
+void container_init(Container* c, ContainerCipher cipher, const uint8_t* key, uint32_t record_size,
+                    int has_index, const uint8_t nonce[CONTAINER_NONCE_SIZE]);
+
+// Reads a header written by container_init(). Returns 0, or -1 with a message
+// if it isn't a container header for this cipher.
+int container_parse(Container* c, ContainerCipher cipher, const uint8_t* key,
+                    const uint8_t header[CONTAINER_HEADER_SIZE]);
+
+// File offset of record index
+uint64_t container_record_offset(const Container* c, uint64_t index);
+
+// Size of the sealed record for len plaintext bytes
+size_t container_sealed_size(const Container* c, size_t len, int final);
+
+// Seals len plaintext bytes (record_size unless final) as record index into
+// out, which needs container_sealed_size() bytes. in may equal out + 4, the
+// ciphertext position, for sealing in place. Returns the record size.
+size_t container_seal(const Container* c, uint64_t index, int final, uint8_t* out, const uint8_t* in, size_t len);
+
+// Checks the length word of the record at in, of which avail bytes are present.
+// Returns the record's size and sets *final, or returns 0 if the length word
+// is invalid or the record is incomplete.
+size_t container_record_size(const Container* c, const uint8_t* in, size_t avail, int* final);
+
+// Authenticates and decrypts the record_len-byte record at in as record index.
+// The plaintext goes to out, which may equal in + 4, and its length to *out_len.
+// Returns 0, or -1 if authentication fails (out then holds nothing usable).
+int container_open(const Container* c, uint64_t index, uint8_t* out, size_t* out_len,
+                   const uint8_t* in, size_t record_len);
+
+// Checks the tag of a record without decrypting it. Returns 0 or -1.
+int container_verify(const Container* c, uint64_t index, const uint8_t* in, size_t record_len);
+
+// Encodes the index for a file of records records and plain_len plaintext bytes
+void container_encode_index(uint8_t out[CONTAINER_INDEX_SIZE], uint64_t records, uint64_t plain_len);
+
+// Reads an index. Returns 0 and fills in the counts, or -1 if it isn't one.
+int container_parse_index(const uint8_t in[CONTAINER_INDEX_SIZE], uint64_t* records, uint64_t* plain_len);
+
+#endif // CONTAINER_H
@@ -0,0 +1,240 @@
+#include "crypto.h"
+#include "chacha20.h"
+#include "tea.h"
+#include "rsa.h"
+#include "threadpool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Worker threads of a context, started on the first batch call that can use
+// them. If they can't be started, batches run on the calling thread.
+typedef struct {
+    size_t threads;
+    ThreadPool* pool;
+} Workers;
+
+static void run_batch(Workers* w, size_t count, pool_task_fn fn, void* arg) {
+    if (w->threads != 1 && count > 1 && !w->pool) w->pool = pool_create(w->threads);
+    if (w->pool && count > 1) {
+        pool_run(w->pool, count, fn, arg);
+    } else {
+        for (size_t i = 0; i < count; ++i) fn(arg, i);
+    }
+}
+
+static void workers_destroy(Workers* w) {
+    if (w->pool) pool_destroy(w->pool);
+}
+
+static int batch_status(const CryptoMessage* msgs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (msgs[i].status != 0) return -1;
+    }
+    return 0;
+}
+
+// --- ChaCha20 ---
+
+struct CryptoChacha20 {
+    uint8_t key[CHACHA20_KEY_SIZE];
+    Workers workers;
+};
+
+typedef struct {
+    CryptoChacha20* ctx;
+    CryptoMessage* msgs;
+} Chacha20MessageBatch;
+
+CryptoChacha20* crypto_chacha20_new(const uint8_t key[CRYPTO_CHACHA20_KEY_SIZE], size_t threads) {
+    CryptoChacha20* ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+    memcpy(ctx->key, key, CHACHA20_KEY_SIZE);
+    ctx->workers.threads = threads;
+    return ctx;
+}
+
+void crypto_chacha20_free(CryptoChacha20* ctx) {
+    if (!ctx) return;
+    workers_destroy(&ctx->workers);
+    memset(ctx->key, 0, sizeof(ctx->key));
+    free(ctx);
+}
+
+void crypto_chacha20_crypt(CryptoChacha20* ctx, uint8_t* out, const uint8_t* in, size_t len,
+                           const uint8_t nonce[CRYPTO_CHACHA20_NONCE_SIZE]) {
+    chacha20_crypt(out, in, len, ctx->key, nonce);
+}
+
+static void chacha20_batch_task(void* arg, size_t index) {
+    Chacha20MessageBatch* batch = arg;
+    CryptoMessage* msg = &batch->msgs[index];
+    crypto_chacha20_crypt(batch->ctx, msg->out, msg->in, msg->len, msg->iv);
+    msg->out_len = msg->len;
+    msg->status = 0;
+}
+
+int crypto_chacha20_crypt_batch(CryptoChacha20* ctx, CryptoMessage* msgs, size_t count) {
+    Chacha20MessageBatch batch = { ctx, msgs };
+    run_batch(&ctx->workers, count, chacha20_batch_task, &batch);
+    return 0;
+}
+
+// --- TEA-CBC ---
+
+struct CryptoTea {
+    uint8_t key[TEA_KEY_SIZE];
+    Workers workers;
+};
+
+typedef struct {
+    CryptoTea* ctx;
+    CryptoMessage* msgs;
+} TeaMessageBatch;
+
+CryptoTea* crypto_tea_new(const uint8_t key[CRYPTO_TEA_KEY_SIZE], size_t threads) {
+    CryptoTea* ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+    memcpy(ctx->key, key, TEA_KEY_SIZE);
+    ctx->workers.threads = threads;
+    return ctx;
+}
+
+void crypto_tea_free(CryptoTea* ctx) {
+    if (!ctx) return;
+    workers_destroy(&ctx->workers);
+    memset(ctx->key, 0, sizeof(ctx->key));
+    free(ctx);
+}
+
+size_t crypto_tea_cbc_encrypt(CryptoTea* ctx, uint8_t* out, const uint8_t* in, size_t len,
+                              const uint8_t iv[CRYPTO_TEA_BLOCK_SIZE]) {
+    uint8_t chain[TEA_BLOCK_SIZE];
+    size_t out_len = CRYPTO_TEA_CBC_OUTPUT_SIZE(len);
+    uint8_t padding_val = (uint8_t)(out_len - len);
+    memcpy(chain, iv, TEA_BLOCK_SIZE);
+    memmove(out, in, len);
+    memset(out + len, padding_val, padding_val);
+    tea_cbc_encrypt(out, out_len, ctx->key, chain);
+    return out_len;
+}
+
+int crypto_tea_cbc_decrypt(CryptoTea* ctx, uint8_t* out, size_t* out_len, const uint8_t* in, size_t len,
+                           const uint8_t iv[CRYPTO_TEA_BLOCK_SIZE]) {
+    uint8_t chain[TEA_BLOCK_SIZE];
+    if (len == 0 || len % TEA_BLOCK_SIZE != 0) return -1;
+    memcpy(chain, iv, TEA_BLOCK_SIZE);
+    memmove(out, in, len);
+    tea_cbc_decrypt(out, len, ctx->key, chain);
+    *out_len = len - tea_cbc_padding_length(out + len - TEA_BLOCK_SIZE);
+    return 0;
+}
+
+static void tea_encrypt_task(void* arg, size_t index) {
+    TeaMessageBatch* batch = arg;
+    CryptoMessage* msg = &batch->msgs[index];
+    msg->out_len = crypto_tea_cbc_encrypt(batch->ctx, msg->out, msg->in, msg->len, msg->iv);
+    msg->status = 0;
+}
+
+static void tea_decrypt_task(void* arg, size_t index) {
+    TeaMessageBatch* batch = arg;
+    CryptoMessage* msg = &batch->msgs[index];
+    msg->status = crypto_tea_cbc_decrypt(batch->ctx, msg->out, &msg->out_len, msg->in, msg->len, msg->iv);
+}
+
+int crypto_tea_cbc_encrypt_batch(CryptoTea* ctx, CryptoMessage* msgs, size_t count) {
+    TeaMessageBatch batch = { ctx, msgs };
+    run_batch(&ctx->workers, count, tea_encrypt_task, &batch);
+    return 0;
+}
+
+int crypto_tea_cbc_decrypt_batch(CryptoTea* ctx, CryptoMessage* msgs, size_t count) {
+    TeaMessageBatch batch = { ctx, msgs };
+    run_batch(&ctx->workers, count, tea_decrypt_task, &batch);
+    return batch_status(msgs, count);
+}
+
+// --- RSA ---
+
+struct CryptoRsa {
+    RsaKey key;
+    Workers workers;
+};
+
+typedef struct {
+    CryptoRsa* ctx;
+    CryptoMessage* msgs;
+} RsaMessageBatch;
+
+CryptoRsa* crypto_rsa_new(const uint8_t* key_data, size_t key_len, size_t threads) {
+    CryptoRsa* ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+    if (rsa_load_key(&ctx->key, key_data, key_len) != 0) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->workers.threads = threads;
+    return ctx;
+}
+
+void crypto_rsa_free(CryptoRsa* ctx) {
+    if (!ctx) return;
+    workers_destroy(&ctx->workers);
+    memset(&ctx->key, 0, sizeof(ctx->key));
+    free(ctx);
+}
+
+size_t crypto_rsa_block_size(const CryptoRsa* ctx) {
+    return ctx->key.bytes;
+}
+
+size_t crypto_rsa_max_data_size(const CryptoRsa* ctx) {
+    return ctx->key.bytes - RSA_PKCS1_OVERHEAD;
+}
+
+int crypto_rsa_encrypt(CryptoRsa* ctx, uint8_t* out, const uint8_t* in, size_t len) {
+    uint8_t block[RSA_MAX_KEY_BYTES];
+    size_t out_len;
+    if (rsa_pad_pkcs1(block, ctx->key.bytes, in, len) != 0) return -1;
+    return rsa_crypt(out, &out_len, block, ctx->key.bytes, &ctx->key);
+}
+
+int crypto_rsa_decrypt(CryptoRsa* ctx, uint8_t* out, size_t* out_len, const uint8_t* in) {
+    const size_t k = ctx->key.bytes;
+    size_t len, offset;
+    if (rsa_crypt(out, &len, in, k, &ctx->key) != 0 || rsa_unpad_pkcs1(out, k, &offset) != 0) return -1;
+    memmove(out, out + offset, k - offset);
+    *out_len = k - offset;
+    return 0;
+}
+
+// Padding draws from the worker's own random generator, so it runs in parallel too
+static void rsa_encrypt_task(void* arg, size_t index) {
+    RsaMessageBatch* batch = arg;
+    CryptoMessage* msg = &batch->msgs[index];
+    msg->status = crypto_rsa_encrypt(batch->ctx, msg->out, msg->in, msg->len);
+    if (msg->status == 0) msg->out_len = batch->ctx->key.bytes;
+}
+
+static void rsa_decrypt_task(void* arg, size_t index) {
+    RsaMessageBatch* batch = arg;
+    CryptoMessage* msg = &batch->msgs[index];
+    if (msg->len != batch->ctx->key.bytes) {
+        msg->status = -1;
+        return;
+    }
+    msg->status = crypto_rsa_decrypt(batch->ctx, msg->out, &msg->out_len, msg->in);
+}
+
+int crypto_rsa_encrypt_batch(CryptoRsa* ctx, CryptoMessage* msgs, size_t count) {
+    RsaMessageBatch batch = { ctx, msgs };
+    run_batch(&ctx->workers, count, rsa_encrypt_task, &batch);
+    return batch_status(msgs, count);
+}
+
+int crypto_rsa_decrypt_batch(CryptoRsa* ctx, CryptoMessage* msgs, size_t count) {
+    RsaMessageBatch batch = { ctx, msgs };
+    run_batch(&ctx->workers, count, rsa_decrypt_task, &batch);
+    return batch_status(msgs, count);
+}
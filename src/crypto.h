@@ -1,8 +1,118 @@
 #ifndef CRYPTO_H
 #define CRYPTO_H
 
-// This file is intentionally empty for this simple project,
-// but could hold shared structures or enums if it grew.
-// Having it is good practice.
+#include <stdint.h>
+#include <stddef.h>
 
-#endif
\ No newline at end of file
+// Public API of the libccrypto library (lib/libccrypto.a and lib/libccrypto.so).
+// Both export only the crypto_* functions below.
+//
+// Each algorithm has a context that holds the parsed key and everything
+// derived from it (RSA Montgomery constants, worker threads), so setup is paid
+// once and every later call goes straight to the cipher. Single-buffer calls
+// run on the calling thread; the *_batch calls spread their messages over the
+// context's worker threads. A context may be used by one thread at a time;
+// use one context per thread to work in parallel.
+//
+// The formats match the crypto CLI without its file headers: ChaCha20 starts
+// at block counter 1, TEA-CBC output carries PKCS#7 padding, and RSA blocks use
+// PKCS#1 v1.5 padding.
+
+#if defined(__GNUC__)
+#define CRYPTO_API __attribute__((visibility("default")))
+#else
+#define CRYPTO_API
+#endif
+
+#define CRYPTO_CHACHA20_KEY_SIZE 32
+#define CRYPTO_CHACHA20_NONCE_SIZE 12
+#define CRYPTO_TEA_KEY_SIZE 16
+#define CRYPTO_TEA_BLOCK_SIZE 8
+
+// Room a TEA-CBC encryption of len bytes needs: padding always adds 1..8 bytes
+#define CRYPTO_TEA_CBC_OUTPUT_SIZE(len) ((len) + CRYPTO_TEA_BLOCK_SIZE - (len) % CRYPTO_TEA_BLOCK_SIZE)
+
+// One message of a batch call
+typedef struct {
+    uint8_t* out;       // Output buffer, see each batch call for its size; may equal in
+    const uint8_t* in;
+    size_t len;         // Input length
+    const uint8_t* iv;  // ChaCha20 nonce or TEA-CBC IV; unused by RSA
+    size_t out_len;     // Set by the call: output length
+    int status;         // Set by the call: 0, or -1 if this message failed
+} CryptoMessage;
+
+// --- ChaCha20 ---
+
+typedef struct CryptoChacha20 CryptoChacha20;
+
+// Creates a context for key. threads sets the workers used by batch calls
+// (0 means one per CPU, 1 runs batches on the calling thread).
+// Returns NULL on allocation failure.
+CRYPTO_API CryptoChacha20* crypto_chacha20_new(const uint8_t key[CRYPTO_CHACHA20_KEY_SIZE], size_t threads);
+CRYPTO_API void crypto_chacha20_free(CryptoChacha20* ctx);
+
+// Encrypts or decrypts len bytes under nonce. out may equal in.
+CRYPTO_API void crypto_chacha20_crypt(CryptoChacha20* ctx, uint8_t* out, const uint8_t* in, size_t len,
+                                      const uint8_t nonce[CRYPTO_CHACHA20_NONCE_SIZE]);
+
+// Encrypts or decrypts every message under its own nonce; out holds len bytes.
+// Returns 0 (ChaCha20 messages cannot fail).
+CRYPTO_API int crypto_chacha20_crypt_batch(CryptoChacha20* ctx, CryptoMessage* msgs, size_t count);
+
+// --- TEA-CBC ---
+
+typedef struct CryptoTea CryptoTea;
+
+// Creates a context for key, with threads as for crypto_chacha20_new().
+CRYPTO_API CryptoTea* crypto_tea_new(const uint8_t key[CRYPTO_TEA_KEY_SIZE], size_t threads);
+CRYPTO_API void crypto_tea_free(CryptoTea* ctx);
+
+// Pads and encrypts len bytes under iv into out, which needs
+// CRYPTO_TEA_CBC_OUTPUT_SIZE(len) bytes and may equal in. Returns the output length.
+CRYPTO_API size_t crypto_tea_cbc_encrypt(CryptoTea* ctx, uint8_t* out, const uint8_t* in, size_t len,
+                                         const uint8_t iv[CRYPTO_TEA_BLOCK_SIZE]);
+
+// Decrypts len bytes (a non-zero multiple of the block size) into out, which
+// needs len bytes and may equal in, and strips the padding. As in the CLI, a
+// last block without valid padding is kept whole.
+// Stores the plaintext length in *out_len. Returns 0, or -1 if len is invalid.
+CRYPTO_API int crypto_tea_cbc_decrypt(CryptoTea* ctx, uint8_t* out, size_t* out_len, const uint8_t* in, size_t len,
+                                      const uint8_t iv[CRYPTO_TEA_BLOCK_SIZE]);
+
+// Batch forms of the two calls above; each out is sized as for the single call.
+// Return 0 if every message succeeded, -1 otherwise (see each message's status).
+CRYPTO_API int crypto_tea_cbc_encrypt_batch(CryptoTea* ctx, CryptoMessage* msgs, size_t count);
+CRYPTO_API int crypto_tea_cbc_decrypt_batch(CryptoTea* ctx, CryptoMessage* msgs, size_t count);
+
+// --- RSA ---
+
+typedef struct CryptoRsa CryptoRsa;
+
+// Parses a key in the CLI's key file layout (see rsa.h) and precomputes its
+// Montgomery contexts, with threads as for crypto_chacha20_new().
+// Returns NULL if the key is invalid or on allocation failure.
+CRYPTO_API CryptoRsa* crypto_rsa_new(const uint8_t* key_data, size_t key_len, size_t threads);
+CRYPTO_API void crypto_rsa_free(CryptoRsa* ctx);
+
+// Modulus size in bytes: the size of every ciphertext block
+CRYPTO_API size_t crypto_rsa_block_size(const CryptoRsa* ctx);
+
+// Largest plaintext one block can carry (block size minus the padding overhead)
+CRYPTO_API size_t crypto_rsa_max_data_size(const CryptoRsa* ctx);
+
+// Pads len bytes (at most crypto_rsa_max_data_size()) and encrypts them into
+// out, which needs crypto_rsa_block_size() bytes. Returns 0 or -1.
+CRYPTO_API int crypto_rsa_encrypt(CryptoRsa* ctx, uint8_t* out, const uint8_t* in, size_t len);
+
+// Decrypts one block of crypto_rsa_block_size() bytes into out, which needs as
+// many bytes and may equal in, and strips the padding. Stores the data length
+// in *out_len. Returns 0, or -1 if the block or its padding is invalid.
+CRYPTO_API int crypto_rsa_decrypt(CryptoRsa* ctx, uint8_t* out, size_t* out_len, const uint8_t* in);
+
+// Batch forms of the two calls above: one block per message, each out sized
+// crypto_rsa_block_size(). Return 0 if every message succeeded, -1 otherwise.
+CRYPTO_API int crypto_rsa_encrypt_batch(CryptoRsa* ctx, CryptoMessage* msgs, size_t count);
+CRYPTO_API int crypto_rsa_decrypt_batch(CryptoRsa* ctx, CryptoMessage* msgs, size_t count);
+
+#endif // CRYPTO_H
@@ -0,0 +1,31 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <stddef.h>
+
+// Run-time kernel selection for chacha20, tea and poly1305. Each keeps a table
+// of kernels, best first with the portable one last, and the index of the
+// active one in an int that starts out as DISPATCH_UNSET. Any thread may be
+// the first to ask, so several can run the checks at once; they all reach the
+// same answer, and the index is published with release/acquire ordering.
+#define DISPATCH_UNSET (-1)
+
+// Index of the active kernel. If none is active yet, picks the first of count
+// that usable() accepts, or the last if none does.
+static inline size_t dispatch_get(int* active, size_t count, int (*usable)(size_t index)) {
+    int index = __atomic_load_n(active, __ATOMIC_ACQUIRE);
+    if (index == DISPATCH_UNSET) {
+        size_t i = 0;
+        while (i + 1 < count && !usable(i)) ++i;
+        index = (int)i;
+        __atomic_store_n(active, index, __ATOMIC_RELEASE);
+    }
+    return (size_t)index;
+}
+
+// Makes kernel index the active one
+static inline void dispatch_set(int* active, size_t index) {
+    __atomic_store_n(active, (int)index, __ATOMIC_RELEASE);
+}
+
+#endif // DISPATCH_H
@@ -0,0 +1,133 @@
+#include "drbg.h"
+#include "chacha20.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/random.h>
+
+// A refill is 16 ChaCha20 blocks, the widest kernel's batch: the next key and
+// this much output
+#define DRBG_BUFFER_SIZE (16 * 64 - CHACHA20_KEY_SIZE)
+#define DRBG_DIRECT_SIZE 256 // Larger requests are generated straight into the output
+
+typedef struct {
+    uint8_t key[CHACHA20_KEY_SIZE];
+    uint8_t buffer[DRBG_BUFFER_SIZE];
+    size_t pos;           // Buffer bytes already handed out (and wiped)
+    uint64_t generated;   // Bytes handed out since the last seed
+    unsigned generation;  // fork_generation at the last seed
+    int seeded;
+} Drbg;
+
+static __thread Drbg drbg;
+static unsigned fork_generation;
+static pthread_once_t drbg_once = PTHREAD_ONCE_INIT;
+static pthread_key_t drbg_exit_key;
+
+// The child of a fork holds a copy of every generator; make them all reseed
+static void drbg_after_fork(void) {
+    fork_generation++;
+}
+
+static void drbg_thread_exit(void* state) {
+    memset(state, 0, sizeof(Drbg));
+}
+
+static void drbg_init(void) {
+    pthread_atfork(NULL, NULL, drbg_after_fork);
+    pthread_key_create(&drbg_exit_key, drbg_thread_exit);
+}
+
+// getrandom() may return less than asked for, or be interrupted by a signal
+static int fill_random(uint8_t* buf, size_t len) {
+    while (len > 0) {
+        ssize_t got = getrandom(buf, len, 0);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += got;
+        len -= (size_t)got;
+    }
+    return 0;
+}
+
+// ChaCha20 keystream of key (zero nonce, counter 0) into out
+static void drbg_keystream(const uint8_t key[CHACHA20_KEY_SIZE], uint8_t* out, size_t len) {
+    static const uint8_t nonce[CHACHA20_NONCE_SIZE];
+    Chacha20Ctx ctx;
+    memset(out, 0, len);
+    chacha20_init(&ctx, key, nonce, 0);
+    chacha20_update(&ctx, out, out, len);
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+static int drbg_seed(Drbg* d) {
+    uint8_t seed[CHACHA20_KEY_SIZE];
+    pthread_once(&drbg_once, drbg_init);
+    if (fill_random(seed, sizeof(seed)) != 0) return -1;
+    // Mixed into the old key, which a reseed never makes weaker
+    for (size_t i = 0; i < sizeof(seed); ++i) d->key[i] ^= seed[i];
+    memset(seed, 0, sizeof(seed));
+    if (!d->seeded) pthread_setspecific(drbg_exit_key, d);
+    memset(d->buffer, 0, DRBG_BUFFER_SIZE);
+    d->pos = DRBG_BUFFER_SIZE;
+    d->generated = 0;
+    d->generation = fork_generation;
+    d->seeded = 1;
+    return 0;
+}
+
+// One keystream run gives the next key and a buffer of output
+static void drbg_refill(Drbg* d) {
+    uint8_t block[CHACHA20_KEY_SIZE + DRBG_BUFFER_SIZE];
+    drbg_keystream(d->key, block, sizeof(block));
+    memcpy(d->key, block, CHACHA20_KEY_SIZE);
+    memcpy(d->buffer, block + CHACHA20_KEY_SIZE, DRBG_BUFFER_SIZE);
+    memset(block, 0, sizeof(block));
+    d->pos = 0;
+}
+
+static void drbg_take(Drbg* d, uint8_t* out, size_t len) {
+    while (len > 0) {
+        if (d->pos == DRBG_BUFFER_SIZE) drbg_refill(d);
+        size_t n = DRBG_BUFFER_SIZE - d->pos;
+        if (n > len) n = len;
+        memcpy(out, d->buffer + d->pos, n);
+        memset(d->buffer + d->pos, 0, n);
+        d->pos += n;
+        out += n;
+        len -= n;
+    }
+}
+
+int drbg_fill(uint8_t* out, size_t len) {
+    Drbg* d = &drbg;
+    if (!d->seeded || d->generation != fork_generation || d->generated >= DRBG_RESEED_INTERVAL) {
+        if (drbg_seed(d) != 0) return -1;
+    }
+    d->generated += len;
+
+    if (len > DRBG_DIRECT_SIZE) {
+        // A one-off key from the generator, whose keystream is the output
+        uint8_t key[CHACHA20_KEY_SIZE];
+        drbg_take(d, key, sizeof(key));
+        drbg_keystream(key, out, len);
+        memset(key, 0, sizeof(key));
+    } else {
+        drbg_take(d, out, len);
+    }
+    return 0;
+}
+
+int drbg_fill_nonzero(uint8_t* out, size_t len) {
+    if (drbg_fill(out, len) != 0) return -1;
+    // Each zero byte is drawn again; about one in 256 needs it
+    for (size_t i = 0; i < len; ++i) {
+        while (out[i] == 0) {
+            if (drbg_fill(out + i, 1) != 0) return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef DRBG_H
+#define DRBG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Random bytes for session keys, nonces, IVs and RSA padding. Every thread
+// runs its own ChaCha20 generator seeded from the kernel (getrandom), so
+// callers never share state or take a lock. Each refill produces a new
+// generator key along with the output ("fast key erasure"), and bytes are
+// wiped once handed out, so neither earlier output nor the current state can
+// be recovered from memory. A generator reseeds after DRBG_RESEED_INTERVAL
+// bytes and in a forked child, which never repeats its parent's output.
+#define DRBG_RESEED_INTERVAL (1ULL << 30)
+
+// Fills out with len random bytes. Returns 0, or -1 with errno set if the
+// kernel can't provide a seed. Prints nothing; callers report errors.
+int drbg_fill(uint8_t* out, size_t len);
+
+// As drbg_fill(), with no zero bytes (PKCS#1 padding)
+int drbg_fill_nonzero(uint8_t* out, size_t len);
+
+#endif // DRBG_H
@@ -0,0 +1,76 @@
+#define _POSIX_C_SOURCE 200809L
+#include "fileio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// Maps [start, start + len) of fd, aligning the mapping down to a page boundary
+static int map_region(FileMap* m, int fd, uint64_t start, size_t len, int prot) {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t map_start = start - start % page;
+    size_t lead = (size_t)(start - map_start);
+
+    void* map = mmap(NULL, lead + len, prot, MAP_SHARED, fd, (off_t)map_start);
+    if (map == MAP_FAILED) return -1;
+    posix_madvise(map, lead + len, POSIX_MADV_SEQUENTIAL);
+
+    m->map = map;
+    m->map_len = lead + len;
+    m->data = (uint8_t*)map + lead;
+    m->len = len;
+    m->fd = fd;
+    m->start = start;
+    return 0;
+}
+
+int fileio_map_input(FileMap* m, FILE* f, uint64_t max_len) {
+    struct stat st;
+    int fd = fileno(f);
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+
+    off_t pos = ftello(f);
+    if (pos < 0 || pos >= st.st_size) return -1;
+    uint64_t len = (uint64_t)(st.st_size - pos);
+    if (len > max_len) len = max_len;
+    if (len == 0 || len > SIZE_MAX) return -1;
+
+    m->fd = -1;
+    return map_region(m, fd, (uint64_t)pos, (size_t)len, PROT_READ);
+}
+
+int fileio_map_output(FileMap* m, FILE* f, size_t len) {
+    struct stat st;
+    int fd = fileno(f);
+    // Anything the caller already wrote through stdio has to reach the file first
+    if (len == 0 || fd < 0 || fflush(f) != 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+    // The mapping needs a descriptor opened for reading as well as writing
+    if ((fcntl(fd, F_GETFL) & O_ACCMODE) != O_RDWR) return -1;
+
+    off_t pos = ftello(f);
+    if (pos < 0) return -1;
+    int err = posix_fallocate(fd, pos, (off_t)len);
+    if (err == ENOSPC || err == EFBIG) {
+        errno = err;
+        perror("Output allocation failed");
+        return -1;
+    }
+    if (err != 0 && ftruncate(fd, pos + (off_t)len) != 0) return -1;
+
+    if (map_region(m, fd, (uint64_t)pos, len, PROT_READ | PROT_WRITE) != 0) {
+        if (ftruncate(fd, pos) != 0) perror("Output truncate failed");
+        return -1;
+    }
+    return 0;
+}
+
+int fileio_unmap(FileMap* m, size_t len) {
+    int status = 0;
+    munmap(m->map, m->map_len);
+    if (m->fd >= 0 && len < m->len && ftruncate(m->fd, (off_t)(m->start + len)) != 0) status = -1;
+    m->map = NULL;
+    return status;
+}
@@ -0,0 +1,36 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Memory-mapped views of the data part of an input or output file, so the
+// ciphers can read and write the page cache directly instead of going through
+// stdio buffers. Only regular files can be mapped; callers fall back to stdio
+// for pipes and terminals.
+typedef struct {
+    uint8_t* data;   // First byte of the view
+    size_t len;      // Length of the view
+    void* map;       // Start of the page-aligned mapping
+    size_t map_len;
+    int fd;          // Output descriptor, -1 for an input map
+    uint64_t start;  // File offset of data[0]
+} FileMap;
+
+// Maps the input from its current position to the end of the file, or at most
+// max_len bytes. Returns 0 on success, -1 if the stream can't be mapped (not
+// a regular file, nothing left to read, or mmap failure).
+int fileio_map_input(FileMap* m, FILE* f, uint64_t max_len);
+
+// Grows the output by len bytes at its current position (preallocating the
+// blocks where the filesystem supports it) and maps that region for writing.
+// Returns 0 on success, -1 if the stream can't be mapped.
+int fileio_map_output(FileMap* m, FILE* f, size_t len);
+
+// Unmaps the view. For an output map, the file is cut to end after the first
+// len bytes of the view (pass m->len to keep all of it).
+// Returns 0 on success, -1 if the output could not be truncated.
+int fileio_unmap(FileMap* m, size_t len);
+
+#endif // FILEIO_H
@@ -4,287 +4,1908 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "tea.h"
 #include "chacha20.h"
+#include "chacha20_poly1305.h"
+#include "container.h"
+#include "drbg.h"
 #include "rsa.h"
+#include "threadpool.h"
+#include "fileio.h"
+#include "pipeline.h"
+#include "stats.h"
 
 #define CHUNK_SIZE 65536 // 64 KB chunk for file processing
+#define STREAM_SEGMENT_SIZE (4 * 1024 * 1024) // Per-thread share of a parallel stream cipher batch
+#define TEA_SEGMENT_SIZE (1024 * 1024) // Per-thread share of a parallel TEA-CBC decryption batch
+#define PIPELINE_CHUNK_SIZE (1024 * 1024) // Chunk size for the I/O pipeline when running on one thread
 
-// For TEA CBC mode, we need to XOR blocks
-void xor_blocks(uint8_t* a, const uint8_t* b, size_t len) {
-    for (size_t i = 0; i < len; ++i) {
-        a[i] ^= b[i];
-    }
-}
+// How file data is moved. Without mmap (and for pipes and terminals), data
+// goes through the I/O pipeline, which uses io_uring for regular files unless
+// stdio is asked for.
+typedef enum {
+    IO_MMAP,
+    IO_URING,
+    IO_STDIO,
+} IoBackend;
+
+// Settings shared by the handlers, filled in from the command line
+typedef struct {
+    size_t threads;   // Worker threads; 0 means one per CPU
+    IoBackend io;
+    int has_range;    // Decrypt only plaintext bytes [offset, offset + length)
+    uint64_t offset;
+    uint64_t length;
+    int container;        // Record container format (tea, chacha20)
+    uint32_t record_size; // Container plaintext bytes per record
+    int no_index;         // Leave out the container's trailing index
+    int resume;           // Finish an interrupted container encryption
+} Options;
+
+// Multi-block RSA file layout: "RSAM", 4-byte big-endian modulus size, then
+// one modulus-sized ciphertext block per (modulus size - 11) bytes of input.
+#define RSA_STREAM_MAGIC "RSAM"
+#define RSA_STREAM_HEADER_SIZE 8
+#define RSA_STREAM_BLOCKS_PER_THREAD 16 // Blocks queued per worker in each batch
+
+// Hybrid file layout: "HYB1", 4-byte big-endian modulus size, the RSA-wrapped
+// ChaCha20 session key (one modulus-sized block), then the ChaCha20 output.
+#define HYBRID_MAGIC "HYB1"
+#define HYBRID_HEADER_SIZE 8
 
 void print_usage(const char* prog_name) {
-    fprintf(stderr, "Usage: %s -e|-d -a <alg> -i <infile> -k <keyfile> -o <outfile>\n", prog_name);
+    fprintf(stderr, "Usage: %s -e|-d -a <alg> (-i <infile> -o <outfile> | --batch <manifest>) -k <keyfile> [-j <threads>] [--offset <n>] [--length <n>] [--container [--record-size <n>] [--no-index] [--resume]] [--io mmap|uring|stdio] [--stats] [--stats-json <file>]\n", prog_name);
     fprintf(stderr, "  -e: encrypt\n");
     fprintf(stderr, "  -d: decrypt\n");
-    fprintf(stderr, "  -a <alg>: algorithm (tea, chacha20, rsa)\n");
-    fprintf(stderr, "  -i <infile>: input file\n");
+    fprintf(stderr, "  -a <alg>: algorithm (tea, tea-ctr, chacha20, xchacha20, chacha20-poly1305, rsa, rsa-stream, hybrid)\n");
+    fprintf(stderr, "  -i <infile>: input file (- for stdin)\n");
     fprintf(stderr, "  -k <keyfile>: key file\n");
-    fprintf(stderr, "  -o <outfile>: output file\n");
+    fprintf(stderr, "  -o <outfile>: output file (- for stdout)\n");
+    fprintf(stderr, "  --batch <manifest>: process every \"<infile> <outfile>\" line of manifest (- for stdin) with one key load\n");
+    fprintf(stderr, "  -j <threads>: worker threads for tea-ctr, chacha20, xchacha20, rsa-stream, hybrid, tea decryption, containers and batches (default: one per CPU)\n");
+    fprintf(stderr, "  --offset <n>, --length <n>: decrypt only this plaintext byte range (tea, tea-ctr, chacha20, xchacha20, hybrid)\n");
+    fprintf(stderr, "  --container: independently authenticated records, for parallel, seekable and resumable processing (tea, chacha20, hybrid)\n");
+    fprintf(stderr, "  --record-size <n>: container plaintext bytes per record, a multiple of 64 (default: 1 MB)\n");
+    fprintf(stderr, "  --no-index: leave out the container's trailing index\n");
+    fprintf(stderr, "  --resume: finish an interrupted container encryption, keeping the records already written\n");
+    fprintf(stderr, "  --io <backend>: mmap (default), uring (pipelined io_uring) or stdio (pipelined stdio)\n");
+    fprintf(stderr, "  --stats: print I/O and crypto timings, block counts and RSA latencies to stderr\n");
+    fprintf(stderr, "  --stats-json <file>: write the same figures as JSON (- for stdout)\n");
+}
+
+// fread()/fwrite() of input and output outside the pipeline (headers, tags,
+// ranges, single RSA blocks), timed and counted in the stats like its I/O
+static size_t read_input(void* buf, size_t len, FILE* f) {
+    uint64_t start = stats_start();
+    size_t got = fread(buf, 1, len, f);
+    stats_stop(STAT_READ, start);
+    stats_add(STAT_BYTES_READ, got);
+    return got;
+}
+
+static size_t write_output(const void* buf, size_t len, FILE* f) {
+    uint64_t start = stats_start();
+    size_t done = fwrite(buf, 1, len, f);
+    stats_stop(STAT_WRITE, start);
+    stats_add(STAT_BYTES_WRITTEN, done);
+    return done;
+}
+
+// The random generator and the RSA code report failures only through their
+// return values; these wrappers print the CLI's messages.
+static int random_fill(uint8_t* buf, size_t len) {
+    if (drbg_fill(buf, len) == 0) return 0;
+    perror("getrandom");
+    return -1;
+}
+
+static int rsa_pad_block(uint8_t* block, size_t block_len, const uint8_t* data, size_t data_len) {
+    if (rsa_pad_pkcs1(block, block_len, data, data_len) == 0) return 0;
+    fprintf(stderr, "Error: Failed to pad RSA block (data too large or no random bytes).\n");
+    return -1;
+}
+
+static int rsa_unpad_block(const uint8_t* block, size_t block_len, size_t* data_offset) {
+    if (rsa_unpad_pkcs1(block, block_len, data_offset) == 0) return 0;
+    fprintf(stderr, "Decryption error or invalid padding.\n");
+    return -1;
+}
+
+static int rsa_crypt_block(uint8_t* out, size_t* out_len, const uint8_t* in, size_t in_len, const RsaKey* key) {
+    if (rsa_crypt(out, out_len, in, in_len, key) == 0) return 0;
+    fprintf(stderr, "Error: RSA block is larger than the %zu-byte modulus.\n", key->bytes);
+    return -1;
+}
+
+// Reads exactly len bytes starting at absolute file position pos
+static int read_at(FILE* f, uint64_t pos, uint8_t* buf, size_t len) {
+    if (fseeko(f, (off_t)pos, SEEK_SET) != 0) return -1;
+    return read_input(buf, len, f) == len ? 0 : -1;
+}
+
+// Cuts off what a failed decryption wrote, where the output can be cut
+static void truncate_output(FILE* out_f, off_t start) {
+    if (start >= 0 && fflush(out_f) == 0 && ftruncate(fileno(out_f), start) != 0) perror("Output truncate failed");
+}
+
+// Moves the input forward by n bytes: a seek for files, reading and discarding
+// for pipes. Hitting the end of the input early is not an error.
+static int skip_input(FILE* f, uint64_t n) {
+    off_t base = ftello(f);
+    if (base >= 0) {
+        if (n > (uint64_t)(INT64_MAX - base) || fseeko(f, base + (off_t)n, SEEK_SET) != 0) {
+            perror("Seek error");
+            return -1;
+        }
+        return 0;
+    }
+    if (errno != ESPIPE) { perror("Seek error"); return -1; }
+
+    uint8_t buf[CHUNK_SIZE];
+    while (n > 0) {
+        size_t got = read_input(buf, n < sizeof(buf) ? n : sizeof(buf), f);
+        if (got == 0) break;
+        n -= got;
+    }
+    if (ferror(f)) { perror("File read error"); return -1; }
+    return 0;
+}
+
+// Decrypts only the requested plaintext range. In CBC, plaintext block i needs
+// nothing but ciphertext blocks i-1 and i (the IV standing in for block -1),
+// so we read the block before the range and then just the blocks covering it.
+static int handle_tea_range(FILE* in_f, FILE* out_f, const uint8_t* key, const Options* opts) {
+    uint8_t buf[CHUNK_SIZE];
+    uint8_t prev[TEA_BLOCK_SIZE];
+
+    if (fseeko(in_f, 0, SEEK_END) != 0) {
+        if (errno == ESPIPE) fprintf(stderr, "Error: TEA range decryption needs a seekable input, not a pipe.\n");
+        else perror("Seek error");
+        return -1;
+    }
+    off_t file_size = ftello(in_f);
+    if (file_size < TEA_BLOCK_SIZE || file_size % TEA_BLOCK_SIZE != 0) {
+        fprintf(stderr, "Error: Input is not a valid TEA ciphertext.\n");
+        return -1;
+    }
+    // Ciphertext block i (after the IV) sits at file position (i + 1) * TEA_BLOCK_SIZE
+    uint64_t blocks = (uint64_t)file_size / TEA_BLOCK_SIZE - 1;
+    if (blocks == 0) return 0;
+
+    // The padding in the last block fixes the plaintext length. Like a full
+    // decryption, a last block without valid padding is kept whole.
+    if (read_at(in_f, (blocks - 1) * TEA_BLOCK_SIZE, buf, 2 * TEA_BLOCK_SIZE) != 0) {
+        perror("File read error");
+        return -1;
+    }
+    memcpy(prev, buf, TEA_BLOCK_SIZE);
+    tea_cbc_decrypt(buf + TEA_BLOCK_SIZE, TEA_BLOCK_SIZE, key, prev);
+    uint8_t padding_val = buf[2 * TEA_BLOCK_SIZE - 1];
+    if (padding_val > TEA_BLOCK_SIZE) padding_val = 0;
+    uint64_t plain_len = blocks * TEA_BLOCK_SIZE - padding_val;
+
+    if (opts->offset >= plain_len || opts->length == 0) return 0;
+    uint64_t end = opts->offset + (opts->length < plain_len - opts->offset ? opts->length : plain_len - opts->offset);
+
+    uint64_t block = opts->offset / TEA_BLOCK_SIZE;
+    uint64_t last_block = (end - 1) / TEA_BLOCK_SIZE;
+    if (read_at(in_f, block * TEA_BLOCK_SIZE, prev, TEA_BLOCK_SIZE) != 0) {
+        perror("File read error");
+        return -1;
+    }
+    while (block <= last_block) {
+        uint64_t count = last_block - block + 1;
+        size_t len = (count < CHUNK_SIZE / TEA_BLOCK_SIZE ? count : CHUNK_SIZE / TEA_BLOCK_SIZE) * TEA_BLOCK_SIZE;
+        if (read_input(buf, len, in_f) != len) {
+            perror("File read error");
+            return -1;
+        }
+        tea_cbc_decrypt(buf, len, key, prev);
+
+        uint64_t pos = block * TEA_BLOCK_SIZE;
+        size_t from = opts->offset > pos ? (size_t)(opts->offset - pos) : 0;
+        size_t to = end < pos + len ? (size_t)(end - pos) : len;
+        if (write_output(buf + from, to - from, out_f) != to - from) {
+            perror("File write error");
+            return -1;
+        }
+        block += len / TEA_BLOCK_SIZE;
+    }
+    return 0;
+}
+
+// Parallel TEA-CBC decryption: each segment of a batch chains from the
+// ciphertext block before it, copied out before the batch is decrypted
+typedef struct {
+    uint8_t* out;
+    const uint8_t* in;              // May equal out for in-place decryption
+    size_t len;
+    const uint8_t* key;
+    uint8_t (*ivs)[TEA_BLOCK_SIZE]; // Chaining block for each segment
+} TeaBatch;
+
+static void tea_segment_task(void* arg, size_t index) {
+    TeaBatch* batch = arg;
+    size_t offset = index * TEA_SEGMENT_SIZE;
+    size_t len = batch->len - offset < TEA_SEGMENT_SIZE ? batch->len - offset : TEA_SEGMENT_SIZE;
+    if (batch->out != batch->in) memcpy(batch->out + offset, batch->in + offset, len);
+    tea_cbc_decrypt(batch->out + offset, len, batch->key, batch->ivs[index]);
+}
+
+// Decrypts len bytes of whole blocks, on the pool if there is one. iv is the
+// ciphertext block before in and is advanced to its last block. ivs needs room
+// for one entry per TEA_SEGMENT_SIZE of input.
+static void tea_cbc_decrypt_batch(ThreadPool* pool, uint8_t* out, const uint8_t* in, size_t len,
+                                  const uint8_t* key, uint8_t* iv, uint8_t (*ivs)[TEA_BLOCK_SIZE]) {
+    size_t segments = (len + TEA_SEGMENT_SIZE - 1) / TEA_SEGMENT_SIZE;
+    memcpy(ivs[0], iv, TEA_BLOCK_SIZE);
+    for (size_t i = 1; i < segments; ++i) {
+        memcpy(ivs[i], in + i * TEA_SEGMENT_SIZE - TEA_BLOCK_SIZE, TEA_BLOCK_SIZE);
+    }
+    memcpy(iv, in + len - TEA_BLOCK_SIZE, TEA_BLOCK_SIZE);
+
+    stats_add(STAT_TEA_BLOCKS, len / TEA_BLOCK_SIZE);
+    TeaBatch batch = { out, in, len, key, ivs };
+    if (pool) {
+        pool_run(pool, segments, tea_segment_task, &batch);
+    } else {
+        for (size_t i = 0; i < segments; ++i) tea_segment_task(&batch, i);
+    }
+}
+
+// CBC encryption straight from the input mapping into the output mapping
+static int tea_encrypt_mapped(FILE* in_f, FILE* out_f, const uint8_t* key, uint8_t* iv) {
+    FileMap in_map, out_map;
+    if (fileio_map_input(&in_map, in_f, UINT64_MAX) != 0) return -1;
+    // PKCS#7 always adds 1..8 bytes, a whole block when the input is block-aligned
+    size_t whole = in_map.len - in_map.len % TEA_BLOCK_SIZE;
+    if (fileio_map_output(&out_map, out_f, whole + TEA_BLOCK_SIZE) != 0) {
+        fileio_unmap(&in_map, in_map.len);
+        return -1;
+    }
+
+    uint64_t start = stats_start();
+    for (size_t done = 0; done < whole; done += CHUNK_SIZE) {
+        size_t len = whole - done < CHUNK_SIZE ? whole - done : CHUNK_SIZE;
+        memcpy(out_map.data + done, in_map.data + done, len);
+        tea_cbc_encrypt(out_map.data + done, len, key, iv);
+    }
+    uint8_t last_block[TEA_BLOCK_SIZE];
+    size_t tail = in_map.len - whole;
+    memcpy(last_block, in_map.data + whole, tail);
+    memset(last_block + tail, TEA_BLOCK_SIZE - tail, TEA_BLOCK_SIZE - tail);
+    tea_cbc_encrypt(last_block, TEA_BLOCK_SIZE, key, iv);
+    memcpy(out_map.data + whole, last_block, TEA_BLOCK_SIZE);
+    stats_stop(STAT_CRYPTO, start);
+    stats_add(STAT_TEA_BLOCKS, whole / TEA_BLOCK_SIZE + 1);
+    stats_add(STAT_BYTES_READ, in_map.len);
+    stats_add(STAT_BYTES_WRITTEN, out_map.len);
+
+    fileio_unmap(&in_map, in_map.len);
+    return fileio_unmap(&out_map, out_map.len) == 0 ? 0 : -1;
+}
+
+// CBC decryption straight from the input mapping into the output mapping.
+// Returns 1 if the files can't be mapped, so the caller falls back to stdio.
+static int tea_decrypt_mapped(FILE* in_f, FILE* out_f, const uint8_t* key, uint8_t* iv, ThreadPool* pool) {
+    FileMap in_map, out_map;
+    if (fileio_map_input(&in_map, in_f, UINT64_MAX) != 0) return 1;
+    // Malformed lengths are left to the stdio path to report
+    if (in_map.len % TEA_BLOCK_SIZE != 0 ||
+        fileio_map_output(&out_map, out_f, in_map.len) != 0) {
+        fileio_unmap(&in_map, in_map.len);
+        return 1;
+    }
+
+    int status = 0;
+    uint8_t (*ivs)[TEA_BLOCK_SIZE] = malloc((in_map.len / TEA_SEGMENT_SIZE + 1) * TEA_BLOCK_SIZE);
+    if (!ivs) {
+        fprintf(stderr, "Memory allocation failed\n");
+        status = -1;
+    } else {
+        uint64_t start = stats_start();
+        tea_cbc_decrypt_batch(pool, out_map.data, in_map.data, in_map.len, key, iv, ivs);
+        stats_stop(STAT_CRYPTO, start);
+        free(ivs);
+    }
+
+    size_t len = in_map.len - (status == 0 ? tea_cbc_padding_length(out_map.data + in_map.len - TEA_BLOCK_SIZE) : 0);
+    stats_add(STAT_BYTES_READ, in_map.len);
+    stats_add(STAT_BYTES_WRITTEN, len);
+    fileio_unmap(&in_map, in_map.len);
+    if (fileio_unmap(&out_map, len) != 0) {
+        perror("Output truncate failed");
+        status = -1;
+    }
+    return status;
+}
+
+static PipelineBackend pipeline_backend(const Options* opts) {
+    return opts->io == IO_STDIO ? PIPELINE_THREADS : PIPELINE_URING;
+}
+
+// Record container (--container, see container.h). Records are sealed and
+// opened independently, so a batch of them is spread over the thread pool.
+typedef struct {
+    const Container* c;
+    uint8_t* out;
+    const uint8_t* in;
+    size_t out_stride;  // Distance between consecutive records' outputs
+    size_t in_stride;   // ... and inputs
+    uint64_t first;     // Index of the batch's first record
+    size_t count;
+    int final;          // The batch ends with the final record
+    size_t last_len;    // Sealing: plaintext bytes of the last record; opening: its record size
+    size_t final_len;   // Opening: plaintext bytes of the last record
+    size_t reused;      // Resuming: records that were already sealed
+    int failed;         // Opening: set by any worker, read once pool_run() has returned
+} ContainerBatch;
+
+static void container_count_blocks(const Container* c, size_t ct_len) {
+    // Plus the keystream that makes the record's IV and MAC key
+    if (c->cipher == CONTAINER_CHACHA20) {
+        stats_add(STAT_CHACHA20_BLOCKS, (ct_len + CHACHA20_BLOCK_SIZE - 1) / CHACHA20_BLOCK_SIZE + 1);
+    } else {
+        stats_add(STAT_TEA_BLOCKS, ct_len / TEA_BLOCK_SIZE + 5);
+    }
+}
+
+static void container_seal_task(void* arg, size_t index) {
+    ContainerBatch* batch = arg;
+    int last = index == batch->count - 1;
+    size_t len = last ? batch->last_len : batch->c->record_size;
+    size_t size = container_seal(batch->c, batch->first + index, last && batch->final,
+                                 batch->out + index * batch->out_stride, batch->in + index * batch->in_stride, len);
+    container_count_blocks(batch->c, size - CONTAINER_RECORD_OVERHEAD);
+}
+
+static void container_open_task(void* arg, size_t index) {
+    ContainerBatch* batch = arg;
+    int last = index == batch->count - 1;
+    size_t size = last ? batch->last_len : batch->c->record_size + CONTAINER_RECORD_OVERHEAD;
+    size_t len;
+    if (container_open(batch->c, batch->first + index, batch->out + index * batch->out_stride, &len,
+                       batch->in + index * batch->in_stride, size) != 0) {
+        __atomic_store_n(&batch->failed, 1, __ATOMIC_RELAXED);
+    } else if (last) {
+        batch->final_len = len;
+    }
+    container_count_blocks(batch->c, size - CONTAINER_RECORD_OVERHEAD);
+}
+
+// Resuming: a record that already authenticates at its place is kept
+static void container_resume_task(void* arg, size_t index) {
+    ContainerBatch* batch = arg;
+    int last = index == batch->count - 1;
+    size_t len = last ? batch->last_len : batch->c->record_size;
+    size_t size = container_sealed_size(batch->c, len, last);
+    const uint8_t* record = batch->out + index * batch->out_stride;
+    int final;
+    if (container_record_size(batch->c, record, size, &final) == size && final == last &&
+        container_verify(batch->c, index, record, size) == 0) {
+        __atomic_fetch_add(&batch->reused, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    container_seal_task(arg, index);
+}
+
+static void container_run(ThreadPool* pool, ContainerBatch* batch, void (*task)(void*, size_t)) {
+    if (pool) {
+        pool_run(pool, batch->count, task, batch);
+    } else {
+        for (size_t i = 0; i < batch->count; ++i) task(batch, i);
+    }
+}
+
+// Every record but the last is full, so the size of the record area fixes the
+// number of records and the size of the final one. Returns the record count,
+// or 0 if no container has a record area of data_len bytes.
+static uint64_t container_record_count(const Container* c, uint64_t data_len, size_t* final_size) {
+    uint64_t stride = (uint64_t)c->record_size + CONTAINER_RECORD_OVERHEAD;
+    size_t min_final = container_sealed_size(c, 0, 1);
+    if (data_len < min_final) return 0;
+    uint64_t count = (data_len - min_final) / stride + 1;
+    *final_size = (size_t)(data_len - (count - 1) * stride);
+    return count;
+}
+
+static int container_malformed(void) {
+    fprintf(stderr, "Error: Container is truncated or malformed.\n");
+    return -1;
+}
+
+static int container_auth_failed(void) {
+    fprintf(stderr, "Error: Authentication failed (file corrupted or wrong key).\n");
+    return -1;
+}
+
+// Checks the index read from the end of a container (NULL if it was cut short)
+// against the records
+static int container_check_index(const uint8_t* index, uint64_t records, uint64_t plain_len) {
+    uint64_t index_records, index_len;
+    if (!index || container_parse_index(index, &index_records, &index_len) != 0 ||
+        index_records != records || index_len != plain_len) {
+        fprintf(stderr, "Error: Container index is missing or does not match the records.\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Seals the whole input from one mapping into the other.
+// Returns 1 if the files can't be mapped, so the caller falls back to the pipeline.
+static int container_encrypt_mapped(FILE* in_f, FILE* out_f, const Container* c, ThreadPool* pool) {
+    FileMap in_map, out_map;
+    if (fileio_map_input(&in_map, in_f, UINT64_MAX) != 0) return 1;
+    size_t R = c->record_size;
+    size_t count = (in_map.len + R - 1) / R;
+    size_t last_len = in_map.len - (count - 1) * R;
+    size_t out_len = (count - 1) * (R + CONTAINER_RECORD_OVERHEAD) + container_sealed_size(c, last_len, 1) +
+                     (c->has_index ? CONTAINER_INDEX_SIZE : 0);
+    if (fileio_map_output(&out_map, out_f, out_len) != 0) {
+        fileio_unmap(&in_map, in_map.len);
+        return 1;
+    }
+
+    ContainerBatch batch = { c, out_map.data, in_map.data, R + CONTAINER_RECORD_OVERHEAD, R, 0, count, 1, last_len, 0, 0, 0 };
+    uint64_t start = stats_start();
+    container_run(pool, &batch, container_seal_task);
+    stats_stop(STAT_CRYPTO, start);
+    if (c->has_index) container_encode_index(out_map.data + out_len - CONTAINER_INDEX_SIZE, count, in_map.len);
+    stats_add(STAT_BYTES_READ, in_map.len);
+    stats_add(STAT_BYTES_WRITTEN, out_len);
+
+    fileio_unmap(&in_map, in_map.len);
+    return fileio_unmap(&out_map, out_len) == 0 ? 0 : -1;
 }
 
-int handle_tea(FILE* in_f, FILE* out_f, const uint8_t* key, int encrypt_mode) {
-    uint8_t in_buf[TEA_BLOCK_SIZE];
-    uint8_t out_buf[TEA_BLOCK_SIZE];
+// Opens every record from the input mapping into the output mapping. The file
+// size gives away where the final record is, so no record has to be scanned.
+// Returns 1 if the files can't be mapped, so the caller falls back to the pipeline.
+static int container_decrypt_mapped(FILE* in_f, FILE* out_f, const Container* c, ThreadPool* pool) {
+    FileMap in_map, out_map;
+    if (fileio_map_input(&in_map, in_f, UINT64_MAX) != 0) return 1;
+    size_t R = c->record_size;
+    size_t index_size = c->has_index ? CONTAINER_INDEX_SIZE : 0;
+    size_t final_size = 0;
+    int final = 0;
+    uint64_t count = in_map.len < index_size ? 0 : container_record_count(c, in_map.len - index_size, &final_size);
+    const uint8_t* last = in_map.data + (count > 0 ? (count - 1) * (R + CONTAINER_RECORD_OVERHEAD) : 0);
+    if (count == 0 || container_record_size(c, last, final_size, &final) != final_size || !final) {
+        fileio_unmap(&in_map, in_map.len);
+        return container_malformed();
+    }
+    size_t out_len = (count - 1) * R + final_size - CONTAINER_RECORD_OVERHEAD;
+    if (fileio_map_output(&out_map, out_f, out_len) != 0) {
+        fileio_unmap(&in_map, in_map.len);
+        return 1;
+    }
+
+    ContainerBatch batch = { c, out_map.data, in_map.data, R, R + CONTAINER_RECORD_OVERHEAD, 0, count, 1, final_size, 0, 0, 0 };
+    uint64_t start = stats_start();
+    container_run(pool, &batch, container_open_task);
+    stats_stop(STAT_CRYPTO, start);
+    int status = batch.failed ? container_auth_failed() : 0;
+    out_len = (count - 1) * R + batch.final_len;
+    if (status == 0 && c->has_index) {
+        status = container_check_index(in_map.data + in_map.len - CONTAINER_INDEX_SIZE, count, out_len);
+    }
+    stats_add(STAT_BYTES_READ, in_map.len);
+    stats_add(STAT_BYTES_WRITTEN, status == 0 ? out_len : 0);
+
+    fileio_unmap(&in_map, in_map.len);
+    // Unauthenticated plaintext is not left behind
+    if (fileio_unmap(&out_map, status == 0 ? out_len : 0) != 0) status = -1;
+    return status;
+}
+
+// State carried from one container pipeline chunk to the next
+typedef struct {
+    const Container* c;
+    ThreadPool* pool;       // NULL runs serially
+    uint64_t next;          // Index of the next record
+    uint64_t plain_len;     // Plaintext bytes so far
+    int done;               // Decrypting: the final record has been opened
+    uint8_t* carry;         // Decrypting: a final record cut by the end of a chunk
+    size_t carry_len;
+    size_t carry_size;
+    uint8_t trailer[CONTAINER_INDEX_SIZE]; // Decrypting: bytes after the final record
+    size_t trailer_len;
+} ContainerStream;
+
+// Chunks hold a whole number of records. They are spread out to their sealed
+// positions, last first, then sealed in place in parallel.
+static int container_encrypt_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    ContainerStream* stream = ctx;
+    const Container* c = stream->c;
+    size_t R = c->record_size, stride = R + CONTAINER_RECORD_OVERHEAD;
+    size_t count = *len > 0 ? (*len + R - 1) / R : 1; // An empty input still gets its final record
+    size_t last_len = *len - (count - 1) * R;
+    for (size_t i = count; i-- > 0; ) {
+        memmove(buf + i * stride + 4, buf + i * R, i == count - 1 ? last_len : R);
+    }
+
+    ContainerBatch batch = { c, buf, buf + 4, stride, stride, stream->next, count, last, last_len, 0, 0, 0 };
+    container_run(stream->pool, &batch, container_seal_task);
+    stream->next += count;
+    stream->plain_len += *len;
+    *len = (count - 1) * stride + container_sealed_size(c, last_len, last);
+    if (last && c->has_index) {
+        container_encode_index(buf + *len, stream->next, stream->plain_len);
+        *len += CONTAINER_INDEX_SIZE;
+    }
+    return 0;
+}
+
+// Everything after the final record has to be the index, if the header announces one
+static int container_add_trailer(ContainerStream* stream, const uint8_t* data, size_t len) {
+    if (len > CONTAINER_INDEX_SIZE - stream->trailer_len) {
+        fprintf(stderr, "Error: Unexpected data after the final container record.\n");
+        return -1;
+    }
+    memcpy(stream->trailer + stream->trailer_len, data, len);
+    stream->trailer_len += len;
+    return 0;
+}
+
+static int container_check_trailer(const ContainerStream* stream) {
+    if (!stream->done) return container_malformed();
+    if (stream->c->has_index) {
+        return container_check_index(stream->trailer_len == CONTAINER_INDEX_SIZE ? stream->trailer : NULL,
+                                     stream->next, stream->plain_len);
+    }
+    if (stream->trailer_len != 0) {
+        fprintf(stderr, "Error: Unexpected data after the final container record.\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Chunks hold whole records, except that a final TEA record, padded past the
+// record size, may run into the next chunk. Records are opened in place in
+// parallel, then their plaintexts are moved together.
+static int container_decrypt_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    ContainerStream* stream = ctx;
+    const Container* c = stream->c;
+    size_t stride = c->record_size + CONTAINER_RECORD_OVERHEAD;
+    size_t n = *len, pos = 0, out_len = 0;
+
+    if (stream->carry_len > 0) {
+        size_t take = stream->carry_size - stream->carry_len < n ? stream->carry_size - stream->carry_len : n;
+        memcpy(stream->carry + stream->carry_len, buf, take);
+        stream->carry_len += take;
+        if (stream->carry_len < stream->carry_size) return container_malformed();
+        if (container_add_trailer(stream, buf + take, n - take) != 0) return -1;
+        if (container_open(c, stream->next, stream->carry + 4, &out_len, stream->carry, stream->carry_size) != 0) {
+            return container_auth_failed();
+        }
+        container_count_blocks(c, stream->carry_size - CONTAINER_RECORD_OVERHEAD);
+        memcpy(buf, stream->carry + 4, out_len);
+        stream->carry_len = 0;
+        stream->next++;
+        stream->done = 1;
+        pos = n;
+    } else if (stream->done) {
+        if (container_add_trailer(stream, buf, n) != 0) return -1;
+        pos = n;
+    }
+
+    size_t count = 0, last_size = 0;
+    int final = 0;
+    while (!final && pos < n) {
+        if (n - pos < 4) return container_malformed();
+        size_t size = container_record_size(c, buf + pos, SIZE_MAX, &final);
+        if (size == 0) return container_malformed();
+        if (size > n - pos) {
+            if (last || !final) return container_malformed();
+            memcpy(stream->carry, buf + pos, n - pos);
+            stream->carry_len = n - pos;
+            stream->carry_size = size;
+            final = 0;
+            break;
+        }
+        pos += size;
+        last_size = size;
+        count++;
+    }
+
+    if (count > 0) {
+        ContainerBatch batch = { c, buf + 4, buf, stride, stride, stream->next, count, final, last_size, 0, 0, 0 };
+        container_run(stream->pool, &batch, container_open_task);
+        if (batch.failed) return container_auth_failed();
+        for (size_t i = 0; i < count; ++i) {
+            size_t plain = i == count - 1 ? batch.final_len : c->record_size;
+            memmove(buf + out_len, buf + i * stride + 4, plain);
+            out_len += plain;
+        }
+        stream->next += count;
+        if (final) {
+            stream->done = 1;
+            if (container_add_trailer(stream, buf + pos, n - pos) != 0) return -1;
+        }
+    }
+    stream->plain_len += out_len;
+    *len = out_len;
+    return last ? container_check_trailer(stream) : 0;
+}
+
+// Decrypts a plaintext range. Record i holds plaintext bytes [i * R, (i + 1) * R)
+// at a fixed position, so only the records covering the range are read, plus
+// the final one, which fixes (and authenticates) the plaintext length.
+static int container_range(FILE* in_f, FILE* out_f, const Container* c, const Options* opts) {
+    struct stat st;
+    off_t base = ftello(in_f);
+    if (base < 0 || fstat(fileno(in_f), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Error: Container range decryption needs a seekable input, not a pipe.\n");
+        return -1;
+    }
+    size_t R = c->record_size;
+    size_t index_size = c->has_index ? CONTAINER_INDEX_SIZE : 0;
+    size_t final_size = 0;
+    uint64_t avail = (uint64_t)(st.st_size > base ? st.st_size - base : 0);
+    uint64_t count = avail < index_size ? 0 : container_record_count(c, avail - index_size, &final_size);
+    if (count == 0) return container_malformed();
+
+    // Records sit at offsets relative to the header, which has been read already
+    base -= CONTAINER_HEADER_SIZE;
+    uint8_t* buf = malloc(R + CONTAINER_RECORD_OVERHEAD + CONTAINER_MAX_PADDING);
+    if (!buf) { fprintf(stderr, "Memory allocation failed\n"); return -1; }
+
+    int status = 0, final;
+    size_t len = 0;
+    if (read_at(in_f, base + container_record_offset(c, count - 1), buf, final_size) != 0) {
+        perror("File read error");
+        status = -1;
+    } else if (container_record_size(c, buf, final_size, &final) != final_size || !final) {
+        status = container_malformed();
+    } else if (container_open(c, count - 1, buf + 4, &len, buf, final_size) != 0) {
+        status = container_auth_failed();
+    }
+    uint64_t plain_len = (count - 1) * R + len;
+    if (status == 0 && c->has_index) {
+        uint8_t index[CONTAINER_INDEX_SIZE];
+        if (read_at(in_f, (uint64_t)st.st_size - CONTAINER_INDEX_SIZE, index, sizeof(index)) != 0) {
+            perror("File read error");
+            status = -1;
+        } else {
+            status = container_check_index(index, count, plain_len);
+        }
+    }
+
+    uint64_t end = plain_len;
+    if (opts->offset < plain_len && opts->length < plain_len - opts->offset) end = opts->offset + opts->length;
+    for (uint64_t i = opts->offset / R; status == 0 && i * R < end; ++i) {
+        size_t size = i == count - 1 ? final_size : R + CONTAINER_RECORD_OVERHEAD;
+        if (read_at(in_f, base + container_record_offset(c, i), buf, size) != 0) {
+            perror("File read error");
+            status = -1;
+        } else if (container_open(c, i, buf + 4, &len, buf, size) != 0) {
+            status = container_auth_failed();
+        } else {
+            uint64_t record_start = i * R;
+            size_t from = opts->offset > record_start ? (size_t)(opts->offset - record_start) : 0;
+            size_t to = end - record_start < len ? (size_t)(end - record_start) : len;
+            container_count_blocks(c, size - CONTAINER_RECORD_OVERHEAD);
+            if (write_output(buf + 4 + from, to - from, out_f) != to - from) {
+                perror("File write error");
+                status = -1;
+            }
+        }
+    }
+    free(buf);
+    return status;
+}
+
+// --resume: finishes an encryption into a container that an earlier run left
+// incomplete. The existing header (nonce, record size, index setting) is kept;
+// records that already authenticate at their place are kept as they are and
+// the others are sealed again. This assumes the input hasn't changed: sealing
+// different data under the same record nonce would reuse keystream.
+// Returns 1 if the output is empty, so a new container is written.
+static int container_resume(FILE* in_f, FILE* out_f, const uint8_t* key, ContainerCipher cipher, ThreadPool* pool) {
+    uint8_t header[CONTAINER_HEADER_SIZE];
+    Container c;
+    off_t out_start = ftello(out_f);
+    size_t got = fread(header, 1, sizeof(header), out_f);
+    if (out_start < 0 || fseeko(out_f, out_start + (off_t)got, SEEK_SET) != 0) {
+        perror("Seek error");
+        return -1;
+    }
+    if (got == 0) return 1;
+    if (got < sizeof(header) || container_parse(&c, cipher, key, header) != 0) {
+        fprintf(stderr, "Error: Output holds no container to resume.\n");
+        return -1;
+    }
+
+    FileMap in_map, out_map;
+    if (fileio_map_input(&in_map, in_f, UINT64_MAX) != 0) {
+        fprintf(stderr, "Error: --resume needs a regular, non-empty input file.\n");
+        return -1;
+    }
+    size_t R = c.record_size;
+    size_t count = (in_map.len + R - 1) / R;
+    size_t last_len = in_map.len - (count - 1) * R;
+    size_t out_len = (count - 1) * (R + CONTAINER_RECORD_OVERHEAD) + container_sealed_size(&c, last_len, 1) +
+                     (c.has_index ? CONTAINER_INDEX_SIZE : 0);
+    if (fileio_map_output(&out_map, out_f, out_len) != 0) {
+        fileio_unmap(&in_map, in_map.len);
+        fprintf(stderr, "Error: --resume needs a regular output file.\n");
+        return -1;
+    }
+
+    ContainerBatch batch = { &c, out_map.data, in_map.data, R + CONTAINER_RECORD_OVERHEAD, R, 0, count, 1, last_len, 0, 0, 0 };
+    uint64_t start = stats_start();
+    container_run(pool, &batch, container_resume_task);
+    stats_stop(STAT_CRYPTO, start);
+    if (c.has_index) container_encode_index(out_map.data + out_len - CONTAINER_INDEX_SIZE, count, in_map.len);
+    stats_add(STAT_BYTES_READ, in_map.len);
+    stats_add(STAT_BYTES_WRITTEN, out_len);
+    printf("Resume: %zu of %zu records were already complete.\n", batch.reused, count);
+
+    fileio_unmap(&in_map, in_map.len);
+    int status = fileio_unmap(&out_map, out_len) == 0 ? 0 : -1;
+    // A longer leftover from an earlier run with a different input goes too
+    if (status == 0 && ftruncate(fileno(out_f), (off_t)out_map.start + (off_t)out_len) != 0) {
+        perror("Output truncate failed");
+        status = -1;
+    }
+    return status;
+}
+
+// Container encryption and decryption for handle_tea() and handle_chacha20().
+// Batches of records go to the thread pool unless a single thread was asked for.
+static int handle_container(FILE* in_f, FILE* out_f, const uint8_t* key, ContainerCipher cipher,
+                            int encrypt_mode, const Options* opts) {
+    Container c;
+    if (!encrypt_mode) {
+        uint8_t header[CONTAINER_HEADER_SIZE];
+        if (read_input(header, sizeof(header), in_f) != sizeof(header)) {
+            fprintf(stderr, "Error: Input file too small (missing container header).\n");
+            return -1;
+        }
+        if (container_parse(&c, cipher, key, header) != 0) return -1;
+        if (opts->has_range) return container_range(in_f, out_f, &c, opts);
+    }
+
+    ThreadPool* pool = NULL;
+    if (opts->threads != 1) {
+        pool = pool_create(opts->threads);
+        if (!pool) { fprintf(stderr, "Failed to start worker threads.\n"); return -1; }
+    }
+
+    int status = 1;
+    if (encrypt_mode) {
+        if (opts->resume) status = container_resume(in_f, out_f, key, cipher, pool);
+        if (status == 1) {
+            uint8_t nonce[CONTAINER_NONCE_SIZE];
+            if (random_fill(nonce, sizeof(nonce)) != 0) {
+                status = -1;
+            } else {
+                container_init(&c, cipher, key, opts->record_size, !opts->no_index, nonce);
+                if (write_output(c.header, CONTAINER_HEADER_SIZE, out_f) != CONTAINER_HEADER_SIZE) {
+                    perror("Failed to write header");
+                    status = -1;
+                }
+            }
+        }
+    }
+    if (status != 1) {
+        if (pool) pool_destroy(pool);
+        return status;
+    }
+
+    // Batches are sized like those of the stream ciphers, but hold at least one record per thread
+    size_t R = c.record_size, stride = R + CONTAINER_RECORD_OVERHEAD;
+    size_t records_per_batch = (pool ? STREAM_SEGMENT_SIZE : PIPELINE_CHUNK_SIZE) / R;
+    if (records_per_batch == 0) records_per_batch = 1;
+    if (pool) records_per_batch *= pool_size(pool);
+    ContainerStream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.c = &c;
+    stream.pool = pool;
+    if (encrypt_mode) {
+        if (opts->io == IO_MMAP) status = container_encrypt_mapped(in_f, out_f, &c, pool);
+        if (status == 1) {
+            // Room for the padding of a final TEA record and the index
+            status = pipeline_run(in_f, out_f, UINT64_MAX, records_per_batch * R,
+                                  records_per_batch * stride + CONTAINER_MAX_PADDING + CONTAINER_INDEX_SIZE,
+                                  pipeline_backend(opts), container_encrypt_chunk, &stream);
+        }
+    } else {
+        off_t out_start = ftello(out_f);
+        if (opts->io == IO_MMAP) status = container_decrypt_mapped(in_f, out_f, &c, pool);
+        if (status == 1) {
+            stream.carry = malloc(stride + CONTAINER_MAX_PADDING);
+            if (!stream.carry) {
+                fprintf(stderr, "Memory allocation failed\n");
+                status = -1;
+            } else {
+                status = pipeline_run(in_f, out_f, UINT64_MAX, records_per_batch * stride, records_per_batch * stride,
+                                      pipeline_backend(opts), container_decrypt_chunk, &stream);
+            }
+            free(stream.carry);
+        }
+        if (status != 0) truncate_output(out_f, out_start);
+    }
+    if (pool) pool_destroy(pool);
+    return status;
+}
+
+// State carried from one TEA-CBC pipeline chunk to the next
+typedef struct {
+    ThreadPool* pool;               // Decryption only; NULL runs serially
+    const uint8_t* key;
+    uint8_t* iv;                    // Chaining block
+    uint8_t (*ivs)[TEA_BLOCK_SIZE]; // Decryption only: room for each segment's chaining block
+} TeaStream;
+
+static int tea_encrypt_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    TeaStream* stream = ctx;
+    if (last) {
+        // PKCS#7 padding at the end of the stream: always 1..8 bytes,
+        // a whole extra block when the input is block-aligned
+        uint8_t padding_val = TEA_BLOCK_SIZE - *len % TEA_BLOCK_SIZE;
+        memset(buf + *len, padding_val, padding_val);
+        *len += padding_val;
+    }
+    tea_cbc_encrypt(buf, *len, stream->key, stream->iv);
+    stats_add(STAT_TEA_BLOCKS, *len / TEA_BLOCK_SIZE);
+    return 0;
+}
+
+static int tea_decrypt_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    TeaStream* stream = ctx;
+    if (*len % TEA_BLOCK_SIZE != 0) {
+        fprintf(stderr, "Error: TEA ciphertext is not a whole number of blocks.\n");
+        return -1;
+    }
+    if (*len == 0) return 0;
+    tea_cbc_decrypt_batch(stream->pool, buf, buf, *len, stream->key, stream->iv, stream->ivs);
+    if (last) *len -= tea_cbc_padding_length(buf + *len - TEA_BLOCK_SIZE);
+    return 0;
+}
+
+int handle_tea(FILE* in_f, FILE* out_f, const uint8_t* key, int encrypt_mode, const Options* opts) {
+    if (opts->container) return handle_container(in_f, out_f, key, CONTAINER_TEA, encrypt_mode, opts);
+    if (!encrypt_mode && opts->has_range) return handle_tea_range(in_f, out_f, key, opts);
+
     uint8_t iv[TEA_BLOCK_SIZE];
-    uint8_t prev_cipher_block[TEA_BLOCK_SIZE];
 
     if (encrypt_mode) {
         // Generate and write a random IV to the start of the output file
-        srand(time(NULL));
-        for(int i=0; i<TEA_BLOCK_SIZE; ++i) iv[i] = rand() % 256;
+        if (random_fill(iv, TEA_BLOCK_SIZE) != 0) return -1;
         
-        if (fwrite(iv, 1, TEA_BLOCK_SIZE, out_f) != TEA_BLOCK_SIZE) {
+        if (write_output(iv, TEA_BLOCK_SIZE, out_f) != TEA_BLOCK_SIZE) {
             perror("Failed to write IV");
             return -1;
         }
-        memcpy(prev_cipher_block, iv, TEA_BLOCK_SIZE);
+        if (opts->io == IO_MMAP && tea_encrypt_mapped(in_f, out_f, key, iv) == 0) return 0;
 
-        size_t bytes_read;
-        while ((bytes_read = fread(in_buf, 1, TEA_BLOCK_SIZE, in_f)) > 0) {
-            // PKCS#7 Padding
-            if (bytes_read < TEA_BLOCK_SIZE) {
-                uint8_t padding_val = TEA_BLOCK_SIZE - bytes_read;
-                memset(in_buf + bytes_read, padding_val, padding_val);
-            }
-            
-            xor_blocks(in_buf, prev_cipher_block, TEA_BLOCK_SIZE);
-            memcpy(out_buf, in_buf, TEA_BLOCK_SIZE);
-            tea_encrypt((uint32_t*)out_buf, (const uint32_t*)key);
-            
-            if (fwrite(out_buf, 1, TEA_BLOCK_SIZE, out_f) != TEA_BLOCK_SIZE) return -1;
-            
-            memcpy(prev_cipher_block, out_buf, TEA_BLOCK_SIZE);
-
-            if (bytes_read < TEA_BLOCK_SIZE) break; // Last block was padded
-        }
-        // If file size is a multiple of block size, add a full padding block
-        if (bytes_read == TEA_BLOCK_SIZE) {
-             memset(in_buf, TEA_BLOCK_SIZE, TEA_BLOCK_SIZE);
-             xor_blocks(in_buf, prev_cipher_block, TEA_BLOCK_SIZE);
-             tea_encrypt((uint32_t*)in_buf, (const uint32_t*)key);
-             fwrite(in_buf, 1, TEA_BLOCK_SIZE, out_f);
-        }
+        // The spare block in each buffer leaves room for the padding
+        TeaStream stream = { NULL, key, iv, NULL };
+        return pipeline_run(in_f, out_f, UINT64_MAX, PIPELINE_CHUNK_SIZE, PIPELINE_CHUNK_SIZE + TEA_BLOCK_SIZE,
+                            pipeline_backend(opts), tea_encrypt_chunk, &stream);
 
     } else { // Decrypt
-        if (fread(iv, 1, TEA_BLOCK_SIZE, in_f) != TEA_BLOCK_SIZE) {
+        if (read_input(iv, TEA_BLOCK_SIZE, in_f) != TEA_BLOCK_SIZE) {
             fprintf(stderr, "Error: Input file too small for TEA decryption (missing IV).\n");
             return -1;
         }
-        memcpy(prev_cipher_block, iv, TEA_BLOCK_SIZE);
 
-        uint8_t temp_cipher_block[TEA_BLOCK_SIZE];
-        size_t bytes_written = 0;
-        size_t total_bytes_read = TEA_BLOCK_SIZE;
+        // CBC decryption is parallel: segments only depend on the ciphertext
+        // block before them. With one thread, chunks are decrypted directly.
+        ThreadPool* pool = NULL;
+        size_t batch_size = PIPELINE_CHUNK_SIZE;
+        if (opts->threads != 1) {
+            pool = pool_create(opts->threads);
+            if (!pool) { fprintf(stderr, "Failed to start worker threads.\n"); return -1; }
+            batch_size = pool_size(pool) * TEA_SEGMENT_SIZE;
+        }
+        if (opts->io == IO_MMAP) {
+            int status = tea_decrypt_mapped(in_f, out_f, key, iv, pool);
+            if (status != 1) {
+                if (pool) pool_destroy(pool);
+                return status;
+            }
+        }
 
-        fseek(in_f, 0, SEEK_END);
-        long file_size = ftell(in_f);
-        fseek(in_f, total_bytes_read, SEEK_SET);
+        TeaStream stream = { pool, key, iv, malloc((batch_size / TEA_SEGMENT_SIZE + 1) * TEA_BLOCK_SIZE) };
+        int status = -1;
+        if (!stream.ivs) {
+            fprintf(stderr, "Memory allocation failed\n");
+        } else {
+            status = pipeline_run(in_f, out_f, UINT64_MAX, batch_size, batch_size, pipeline_backend(opts),
+                                  tea_decrypt_chunk, &stream);
+        }
+        free(stream.ivs);
+        if (pool) pool_destroy(pool);
+        return status;
+    }
+    return 0;
+}
 
 
-        while (fread(in_buf, 1, TEA_BLOCK_SIZE, in_f) == TEA_BLOCK_SIZE) {
-            total_bytes_read += TEA_BLOCK_SIZE;
-            memcpy(temp_cipher_block, in_buf, TEA_BLOCK_SIZE);
-            memcpy(out_buf, in_buf, TEA_BLOCK_SIZE);
+// Seekable stream ciphers map a stream offset straight to keystream, so a
+// batch can be cut into segments and each one processed on its own.
+// out may equal in.
+typedef void (*stream_crypt_fn)(uint8_t* out, const uint8_t* in, size_t len, uint64_t offset, const void* cipher);
 
-            tea_decrypt((uint32_t*)out_buf, (const uint32_t*)key);
-            xor_blocks(out_buf, prev_cipher_block, TEA_BLOCK_SIZE);
-            
-            memcpy(prev_cipher_block, temp_cipher_block, TEA_BLOCK_SIZE);
+typedef struct {
+    uint8_t* out;
+    const uint8_t* in;
+    size_t len;
+    uint64_t offset; // Stream offset of in[0]
+    stream_crypt_fn crypt;
+    const void* cipher;
+} StreamBatch;
 
-            // Handle unpadding on the last block
-            if (total_bytes_read == (size_t)file_size) {
-                uint8_t padding_val = out_buf[TEA_BLOCK_SIZE - 1];
-                 if (padding_val > 0 && padding_val <= TEA_BLOCK_SIZE) {
-                     bytes_written = TEA_BLOCK_SIZE - padding_val;
-                 }
-            } else {
-                bytes_written = TEA_BLOCK_SIZE;
-            }
-             if (fwrite(out_buf, 1, bytes_written, out_f) != bytes_written) return -1;
-        }
+static void stream_segment_task(void* arg, size_t index) {
+    StreamBatch* batch = arg;
+    size_t offset = index * STREAM_SEGMENT_SIZE;
+    size_t len = batch->len - offset < STREAM_SEGMENT_SIZE ? batch->len - offset : STREAM_SEGMENT_SIZE;
+    batch->crypt(batch->out + offset, batch->in + offset, len, batch->offset + offset, batch->cipher);
+}
+
+static void stream_run_batch(ThreadPool* pool, StreamBatch* batch) {
+    size_t segments = (batch->len + STREAM_SEGMENT_SIZE - 1) / STREAM_SEGMENT_SIZE;
+    if (pool) {
+        pool_run(pool, segments, stream_segment_task, batch);
+    } else {
+        for (size_t i = 0; i < segments; ++i) stream_segment_task(batch, i);
     }
+}
+
+typedef struct {
+    ThreadPool* pool;
+    StreamBatch* batch;
+} StreamPipeline;
+
+static int stream_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    (void)last;
+    StreamPipeline* stream = ctx;
+    stream->batch->out = buf;
+    stream->batch->in = buf;
+    stream->batch->len = *len;
+    stream_run_batch(stream->pool, stream->batch);
+    stream->batch->offset += *len;
     return 0;
 }
 
+// Runs a stream cipher over the rest of in_f. Regular files are mapped and
+// processed from one mapping into the other; otherwise data goes through the
+// read/process/write pipeline. Batches go to the thread pool unless a single thread was
+// asked for. When decrypting a range, only the requested bytes are read, and
+// the keystream starts at the range offset.
+static int process_stream(FILE* in_f, FILE* out_f, int encrypt_mode, const Options* opts,
+                          stream_crypt_fn crypt, const void* cipher) {
+    uint64_t remaining = UINT64_MAX;
+    StreamBatch batch = { NULL, NULL, 0, 0, crypt, cipher };
+    if (!encrypt_mode && opts->has_range) {
+        if (skip_input(in_f, opts->offset) != 0) return -1;
+        batch.offset = opts->offset;
+        remaining = opts->length;
+    }
+
+    ThreadPool* pool = NULL;
+    size_t batch_size = PIPELINE_CHUNK_SIZE;
+    if (opts->threads != 1) {
+        pool = pool_create(opts->threads);
+        if (!pool) { fprintf(stderr, "Failed to start worker threads.\n"); return -1; }
+        batch_size = pool_size(pool) * STREAM_SEGMENT_SIZE;
+    }
+
+    int status = 0;
+    FileMap in_map, out_map;
+    if (opts->io == IO_MMAP && fileio_map_input(&in_map, in_f, remaining) == 0) {
+        if (fileio_map_output(&out_map, out_f, in_map.len) == 0) {
+            batch.out = out_map.data;
+            batch.in = in_map.data;
+            batch.len = in_map.len;
+            uint64_t start = stats_start();
+            stream_run_batch(pool, &batch);
+            stats_stop(STAT_CRYPTO, start);
+            stats_add(STAT_BYTES_READ, in_map.len);
+            stats_add(STAT_BYTES_WRITTEN, out_map.len);
+            fileio_unmap(&in_map, in_map.len);
+            fileio_unmap(&out_map, out_map.len);
+            if (pool) pool_destroy(pool);
+            return 0;
+        }
+        fileio_unmap(&in_map, in_map.len);
+    }
+
+    // Otherwise chunks are processed in place as the pipeline hands them over
+    StreamPipeline stream = { pool, &batch };
+    status = pipeline_run(in_f, out_f, remaining, batch_size, batch_size, pipeline_backend(opts),
+                          stream_chunk, &stream);
+    if (pool) pool_destroy(pool);
+    return status;
+}
+
+typedef struct {
+    const uint8_t* key;
+    const uint8_t* nonce;
+} Chacha20Cipher;
+
+// The block counter runs continuously across the whole file (starting at 1),
+// so every chunk gets fresh keystream and any split of the file produces
+// the same output.
+static void chacha20_stream_crypt(uint8_t* out, const uint8_t* in, size_t len, uint64_t offset, const void* cipher) {
+    const Chacha20Cipher* c = cipher;
+    Chacha20Ctx ctx;
+    chacha20_init(&ctx, c->key, c->nonce, 1);
+    chacha20_seek(&ctx, offset);
+    chacha20_update(&ctx, out, in, len);
+    stats_add(STAT_CHACHA20_BLOCKS, (offset + len + CHACHA20_BLOCK_SIZE - 1) / CHACHA20_BLOCK_SIZE - offset / CHACHA20_BLOCK_SIZE);
+}
+
+int handle_chacha20(FILE* in_f, FILE* out_f, const uint8_t* key, int encrypt_mode, const Options* opts) {
+    if (opts->container) return handle_container(in_f, out_f, key, CONTAINER_CHACHA20, encrypt_mode, opts);
 
-int handle_chacha20(FILE* in_f, FILE* out_f, const uint8_t* key, int encrypt_mode) {
-    uint8_t in_buf[CHUNK_SIZE];
-    uint8_t out_buf[CHUNK_SIZE];
     uint8_t nonce[CHACHA20_NONCE_SIZE];
 
     if (encrypt_mode) {
         // Generate and write a random nonce
-        srand(time(NULL));
-        for(int i=0; i<CHACHA20_NONCE_SIZE; ++i) nonce[i] = rand() % 256;
-        if (fwrite(nonce, 1, CHACHA20_NONCE_SIZE, out_f) != CHACHA20_NONCE_SIZE) {
+        if (random_fill(nonce, CHACHA20_NONCE_SIZE) != 0) return -1;
+        if (write_output(nonce, CHACHA20_NONCE_SIZE, out_f) != CHACHA20_NONCE_SIZE) {
             perror("Failed to write nonce");
             return -1;
         }
     } else {
-        if (fread(nonce, 1, CHACHA20_NONCE_SIZE, in_f) != CHACHA20_NONCE_SIZE) {
+        if (read_input(nonce, CHACHA20_NONCE_SIZE, in_f) != CHACHA20_NONCE_SIZE) {
             fprintf(stderr, "Error: Input file too small (missing nonce).\n");
             return -1;
         }
     }
-    
-    size_t bytes_read;
-    while ((bytes_read = fread(in_buf, 1, CHUNK_SIZE, in_f)) > 0) {
-        chacha20_crypt(out_buf, in_buf, bytes_read, key, nonce);
-        if (fwrite(out_buf, 1, bytes_read, out_f) != bytes_read) {
-            perror("File write error");
+
+    Chacha20Cipher cipher = { key, nonce };
+    return process_stream(in_f, out_f, encrypt_mode, opts, chacha20_stream_crypt, &cipher);
+}
+
+// XChaCha20 output: the 24-byte nonce, then the ciphertext. The nonce is long
+// enough to be drawn at random for every file, however many jobs run at once.
+// The body is ChaCha20 under the HChaCha20 subkey, so it is as parallel and
+// seekable as chacha20.
+int handle_xchacha20(FILE* in_f, FILE* out_f, const uint8_t* key, int encrypt_mode, const Options* opts) {
+    uint8_t xnonce[XCHACHA20_NONCE_SIZE];
+
+    if (encrypt_mode) {
+        if (random_fill(xnonce, XCHACHA20_NONCE_SIZE) != 0) return -1;
+        if (write_output(xnonce, XCHACHA20_NONCE_SIZE, out_f) != XCHACHA20_NONCE_SIZE) {
+            perror("Failed to write nonce");
             return -1;
         }
+    } else {
+        if (read_input(xnonce, XCHACHA20_NONCE_SIZE, in_f) != XCHACHA20_NONCE_SIZE) {
+            fprintf(stderr, "Error: Input file too small (missing nonce).\n");
+            return -1;
+        }
+    }
+
+    uint8_t subkey[CHACHA20_KEY_SIZE], nonce[CHACHA20_NONCE_SIZE];
+    xchacha20_derive(subkey, nonce, key, xnonce);
+    Chacha20Cipher cipher = { subkey, nonce };
+    int status = process_stream(in_f, out_f, encrypt_mode, opts, chacha20_stream_crypt, &cipher);
+    memset(subkey, 0, sizeof(subkey));
+    return status;
+}
+
+// ChaCha20-Poly1305 output: nonce, ciphertext, then the 16-byte tag over the
+// ciphertext. The MAC chain is sequential, so the file is processed on one
+// thread, with encryption and authentication fused per chunk.
+typedef struct {
+    Chacha20Poly1305Ctx aead;
+    int hold_tag;                             // Input length unknown: keep back the last bytes of each chunk
+    uint8_t tail[CHACHA20_POLY1305_TAG_SIZE]; // Bytes kept back, which end up being the tag
+    size_t tail_len;
+} AeadStream;
+
+static void aead_count_blocks(uint64_t offset, size_t len) {
+    stats_add(STAT_CHACHA20_BLOCKS, (offset + len + CHACHA20_BLOCK_SIZE - 1) / CHACHA20_BLOCK_SIZE - offset / CHACHA20_BLOCK_SIZE);
+}
+
+static int aead_check_tag(Chacha20Poly1305Ctx* aead, const uint8_t* received) {
+    uint8_t tag[CHACHA20_POLY1305_TAG_SIZE];
+    chacha20_poly1305_final(aead, tag);
+    if (poly1305_verify(tag, received) != 0) {
+        fprintf(stderr, "Error: Authentication failed (file corrupted or wrong key).\n");
+        return -1;
     }
     return 0;
 }
 
+static int aead_encrypt_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    AeadStream* stream = ctx;
+    aead_count_blocks(stream->aead.data_len, *len);
+    chacha20_poly1305_encrypt(&stream->aead, buf, buf, *len);
+    if (last) {
+        chacha20_poly1305_final(&stream->aead, buf + *len);
+        *len += CHACHA20_POLY1305_TAG_SIZE;
+    }
+    return 0;
+}
 
-int handle_rsa(FILE* in_f, FILE* out_f, const uint8_t* key_bytes, int encrypt_mode) {
-    RsaKey key;
-    uint8_t in_buf[RSA_KEY_BYTES];
-    uint8_t out_buf[RSA_KEY_BYTES];
-    
-    // Key file format: 128 bytes modulus, then 128 bytes exponent
-    bignum_from_bytes(&key.modulus, key_bytes, RSA_KEY_BYTES);
-    bignum_from_bytes(&key.exponent, key_bytes + RSA_KEY_BYTES, RSA_KEY_BYTES);
+static int aead_decrypt_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    AeadStream* stream = ctx;
+    if (stream->hold_tag) {
+        // Put the bytes kept back from the previous chunk in front, and keep
+        // back the last ones of this chunk in case the input ends here
+        size_t total = stream->tail_len + *len;
+        memmove(buf + stream->tail_len, buf, *len);
+        memcpy(buf, stream->tail, stream->tail_len);
+        stream->tail_len = total < CHACHA20_POLY1305_TAG_SIZE ? total : CHACHA20_POLY1305_TAG_SIZE;
+        *len = total - stream->tail_len;
+        memcpy(stream->tail, buf + *len, stream->tail_len);
+    }
+    aead_count_blocks(stream->aead.data_len, *len);
+    chacha20_poly1305_decrypt(&stream->aead, buf, buf, *len);
+    if (!last || !stream->hold_tag) return 0;
+    if (stream->tail_len < CHACHA20_POLY1305_TAG_SIZE) {
+        fprintf(stderr, "Error: Input file too small (missing tag).\n");
+        return -1;
+    }
+    return aead_check_tag(&stream->aead, stream->tail);
+}
+
+// Maps both files and runs the AEAD from one mapping into the other.
+// Returns 1 if the files can't be mapped, so the caller falls back to the pipeline.
+static int aead_mapped(FILE* in_f, FILE* out_f, Chacha20Poly1305Ctx* aead, int encrypt_mode) {
+    FileMap in_map, out_map;
+    if (fileio_map_input(&in_map, in_f, UINT64_MAX) != 0) return 1;
+    size_t data_len = in_map.len;
+    if (!encrypt_mode) {
+        if (in_map.len < CHACHA20_POLY1305_TAG_SIZE) {
+            fileio_unmap(&in_map, in_map.len);
+            fprintf(stderr, "Error: Input file too small (missing tag).\n");
+            return -1;
+        }
+        data_len -= CHACHA20_POLY1305_TAG_SIZE;
+    }
+    size_t out_len = encrypt_mode ? data_len + CHACHA20_POLY1305_TAG_SIZE : data_len;
+    if (out_len == 0 || fileio_map_output(&out_map, out_f, out_len) != 0) {
+        fileio_unmap(&in_map, in_map.len);
+        return 1;
+    }
+
+    int status = 0;
+    uint64_t start = stats_start();
+    aead_count_blocks(0, data_len);
+    if (encrypt_mode) {
+        chacha20_poly1305_encrypt(aead, out_map.data, in_map.data, data_len);
+        chacha20_poly1305_final(aead, out_map.data + data_len);
+    } else {
+        chacha20_poly1305_decrypt(aead, out_map.data, in_map.data, data_len);
+        status = aead_check_tag(aead, in_map.data + data_len);
+    }
+    stats_stop(STAT_CRYPTO, start);
+    stats_add(STAT_BYTES_READ, in_map.len);
+    stats_add(STAT_BYTES_WRITTEN, out_len);
+
+    fileio_unmap(&in_map, in_map.len);
+    // Unauthenticated plaintext is not left behind
+    if (fileio_unmap(&out_map, status == 0 ? out_len : 0) != 0) status = -1;
+    return status;
+}
+
+int handle_chacha20_poly1305(FILE* in_f, FILE* out_f, const uint8_t* key, int encrypt_mode, const Options* opts) {
+    uint8_t nonce[CHACHA20_NONCE_SIZE];
+
+    if (encrypt_mode) {
+        if (random_fill(nonce, CHACHA20_NONCE_SIZE) != 0) return -1;
+        if (write_output(nonce, CHACHA20_NONCE_SIZE, out_f) != CHACHA20_NONCE_SIZE) {
+            perror("Failed to write nonce");
+            return -1;
+        }
+    } else {
+        if (read_input(nonce, CHACHA20_NONCE_SIZE, in_f) != CHACHA20_NONCE_SIZE) {
+            fprintf(stderr, "Error: Input file too small (missing nonce).\n");
+            return -1;
+        }
+    }
+
+    AeadStream stream;
+    memset(&stream, 0, sizeof(stream));
+    chacha20_poly1305_init(&stream.aead, key, nonce);
+    if (opts->io == IO_MMAP) {
+        int status = aead_mapped(in_f, out_f, &stream.aead, encrypt_mode);
+        if (status != 1) return status;
+    }
+
+    if (encrypt_mode) {
+        return pipeline_run(in_f, out_f, UINT64_MAX, PIPELINE_CHUNK_SIZE, PIPELINE_CHUNK_SIZE + CHACHA20_POLY1305_TAG_SIZE,
+                            pipeline_backend(opts), aead_encrypt_chunk, &stream);
+    }
+
+    // When the input size is known the tag is read on its own after the
+    // ciphertext; otherwise it has to be kept back from the stream
+    uint64_t data_len = UINT64_MAX;
+    struct stat st;
+    off_t in_pos = ftello(in_f);
+    off_t out_start = ftello(out_f);
+    if (in_pos >= 0 && fstat(fileno(in_f), &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size - in_pos < CHACHA20_POLY1305_TAG_SIZE) {
+            fprintf(stderr, "Error: Input file too small (missing tag).\n");
+            return -1;
+        }
+        data_len = (uint64_t)(st.st_size - in_pos - CHACHA20_POLY1305_TAG_SIZE);
+    } else {
+        stream.hold_tag = 1;
+    }
+
+    int status = pipeline_run(in_f, out_f, data_len, PIPELINE_CHUNK_SIZE, PIPELINE_CHUNK_SIZE + CHACHA20_POLY1305_TAG_SIZE,
+                              pipeline_backend(opts), aead_decrypt_chunk, &stream);
+    if (status == 0 && !stream.hold_tag) {
+        uint8_t tag[CHACHA20_POLY1305_TAG_SIZE];
+        if (read_input(tag, sizeof(tag), in_f) != sizeof(tag)) {
+            fprintf(stderr, "Error: Input file too small (missing tag).\n");
+            status = -1;
+        } else {
+            status = aead_check_tag(&stream.aead, tag);
+        }
+    }
+    // Unauthenticated plaintext is not left behind
+    if (status != 0) truncate_output(out_f, out_start);
+    return status;
+}
+
+typedef struct {
+    const uint8_t* key;
+    uint64_t iv;
+} TeaCtrCipher;
+
+static void tea_ctr_stream_crypt(uint8_t* out, const uint8_t* in, size_t len, uint64_t offset, const void* cipher) {
+    const TeaCtrCipher* c = cipher;
+    tea_ctr_crypt(out, in, len, c->key, c->iv, offset);
+    stats_add(STAT_TEA_BLOCKS, (offset + len + TEA_BLOCK_SIZE - 1) / TEA_BLOCK_SIZE - offset / TEA_BLOCK_SIZE);
+}
+
+// TEA in counter mode: an 8-byte IV (the big-endian initial counter), then
+// ciphertext exactly as long as the plaintext. No padding, fully parallel
+// and seekable in both directions.
+int handle_tea_ctr(FILE* in_f, FILE* out_f, const uint8_t* key, int encrypt_mode, const Options* opts) {
+    uint8_t iv[TEA_BLOCK_SIZE];
+
+    if (encrypt_mode) {
+        // Generate and write a random IV
+        if (random_fill(iv, TEA_BLOCK_SIZE) != 0) return -1;
+        if (write_output(iv, TEA_BLOCK_SIZE, out_f) != TEA_BLOCK_SIZE) {
+            perror("Failed to write IV");
+            return -1;
+        }
+    } else {
+        if (read_input(iv, TEA_BLOCK_SIZE, in_f) != TEA_BLOCK_SIZE) {
+            fprintf(stderr, "Error: Input file too small for TEA-CTR decryption (missing IV).\n");
+            return -1;
+        }
+    }
+
+    TeaCtrCipher cipher = { key, 0 };
+    for (int i = 0; i < TEA_BLOCK_SIZE; ++i) cipher.iv = (cipher.iv << 8) | iv[i];
+    return process_stream(in_f, out_f, encrypt_mode, opts, tea_ctr_stream_crypt, &cipher);
+}
+
+
+int handle_rsa(FILE* in_f, FILE* out_f, const RsaKey* key, int encrypt_mode) {
+    uint8_t in_buf[RSA_MAX_KEY_BYTES];
+    uint8_t out_buf[RSA_MAX_KEY_BYTES];
+    const size_t block_len = key->bytes;
 
     if (encrypt_mode) {
         // Pad and encrypt. PKCS#1.5 requires 11 bytes of overhead.
-        const size_t max_data_len = RSA_KEY_BYTES - 11;
-        uint8_t padded_block[RSA_KEY_BYTES] = {0};
+        const size_t max_data_len = block_len - RSA_PKCS1_OVERHEAD;
+        uint8_t padded_block[RSA_MAX_KEY_BYTES];
 
-        size_t bytes_read = fread(in_buf, 1, max_data_len, in_f);
+        size_t bytes_read = read_input(in_buf, max_data_len, in_f);
         if (bytes_read == 0) {
              fprintf(stderr, "Input file is empty.\n");
              return -1;
         }
         
         // PKCS#1 v1.5 Encryption Padding
-        padded_block[0] = 0x00;
-        padded_block[1] = 0x02; // Block type 2 for encryption
-        // Fill with random non-zero bytes
-        for (size_t i = 2; i < RSA_KEY_BYTES - bytes_read - 1; ++i) {
-            do {
-                padded_block[i] = rand() % 256;
-            } while (padded_block[i] == 0);
-        }
-        padded_block[RSA_KEY_BYTES - bytes_read - 1] = 0x00;
-        memcpy(padded_block + RSA_KEY_BYTES - bytes_read, in_buf, bytes_read);
+        if (rsa_pad_block(padded_block, block_len, in_buf, bytes_read) != 0) return -1;
 
         size_t out_len;
-        if (rsa_crypt(out_buf, &out_len, padded_block, RSA_KEY_BYTES, &key) != 0) {
+        uint64_t start = stats_start();
+        if (rsa_crypt_block(out_buf, &out_len, padded_block, block_len, key) != 0) {
             return -1;
         }
-        if (fwrite(out_buf, 1, out_len, out_f) != out_len) return -1;
+        stats_modexp(start);
+        if (write_output(out_buf, out_len, out_f) != out_len) return -1;
 
     } else { // Decrypt
-        size_t bytes_read = fread(in_buf, 1, RSA_KEY_BYTES, in_f);
+        size_t bytes_read = read_input(in_buf, block_len, in_f);
          if (bytes_read == 0) return 0;
-         if (bytes_read != RSA_KEY_BYTES) {
+         if (bytes_read != block_len) {
               fprintf(stderr, "Error: Invalid RSA ciphertext size.\n");
               return -1;
          }
 
         size_t out_len;
-        if (rsa_crypt(out_buf, &out_len, in_buf, bytes_read, &key) != 0) return -1;
+        uint64_t start = stats_start();
+        if (rsa_crypt_block(out_buf, &out_len, in_buf, bytes_read, key) != 0) return -1;
+        stats_modexp(start);
         
         // Unpad PKCS#1 v1.5
-        if (out_buf[0] != 0x00 || out_buf[1] != 0x02) {
-            fprintf(stderr, "Decryption error or invalid padding.\n");
-            return -1;
-        }
-        
-        // Find the 0x00 separator
-        size_t i = 2;
-        while(i < out_len && out_buf[i] != 0x00) { i++; }
+        size_t i;
+        if (rsa_unpad_block(out_buf, out_len, &i) != 0) return -1;
         
-        if (i >= out_len || i < 10) { // At least 8 random bytes + separator
-            fprintf(stderr, "Padding error.\n");
+        if (write_output(out_buf + i, out_len - i, out_f) != (out_len - i)) return -1;
+    }
+    return 0;
+}
+
+
+// Multi-block RSA: every block is independent, so a batch of them is
+// exponentiated in parallel on the thread pool.
+typedef struct {
+    const RsaKey* key;
+    const uint8_t* in;
+    uint8_t* out;
+    int failed; // Set by any worker; read once pool_run() has returned
+} RsaBatch;
+
+static void rsa_batch_task(void* arg, size_t index) {
+    RsaBatch* batch = arg;
+    size_t k = batch->key->bytes;
+    size_t out_len;
+    uint64_t start = stats_start();
+    if (rsa_crypt_block(batch->out + index * k, &out_len, batch->in + index * k, k, batch->key) != 0) {
+        __atomic_store_n(&batch->failed, 1, __ATOMIC_RELAXED);
+    }
+    stats_modexp(start);
+}
+
+typedef struct {
+    ThreadPool* pool;
+    RsaBatch batch;
+    int encrypt_mode;
+    uint8_t* scratch; // One batch of whole blocks
+} RsaStream;
+
+// Pipeline callback: encrypts a chunk of plaintext into whole blocks, or
+// decrypts a chunk of blocks back to plaintext, in buf.
+static int rsa_stream_chunk(void* ctx, uint8_t* buf, size_t* len, int last) {
+    (void)last;
+    RsaStream* stream = ctx;
+    const size_t k = stream->batch.key->bytes;
+    const size_t data_len = k - RSA_PKCS1_OVERHEAD;
+    size_t blocks;
+
+    if (*len == 0) return 0;
+    if (stream->encrypt_mode) {
+        blocks = (*len + data_len - 1) / data_len;
+        for (size_t b = 0; b < blocks; ++b) {
+            size_t n = (b == blocks - 1) ? *len - b * data_len : data_len;
+            if (rsa_pad_block(stream->scratch + b * k, k, buf + b * data_len, n) != 0) return -1;
+        }
+        stream->batch.in = stream->scratch;
+        stream->batch.out = buf;
+    } else {
+        if (*len % k != 0) {
+            fprintf(stderr, "Error: Invalid RSA ciphertext size.\n");
             return -1;
         }
-        i++; // Move past the separator
-        
-        if (fwrite(out_buf + i, 1, out_len - i, out_f) != (out_len - i)) return -1;
+        blocks = *len / k;
+        stream->batch.in = buf;
+        stream->batch.out = stream->scratch;
+    }
+
+    pool_run(stream->pool, blocks, rsa_batch_task, &stream->batch);
+    if (stream->batch.failed) return -1;
+
+    if (stream->encrypt_mode) {
+        *len = blocks * k;
+        return 0;
+    }
+    size_t out_len = 0;
+    for (size_t b = 0; b < blocks; ++b) {
+        const uint8_t* block = stream->scratch + b * k;
+        size_t offset = 0;
+        if (rsa_unpad_block(block, k, &offset) != 0) return -1;
+        memcpy(buf + out_len, block + offset, k - offset);
+        out_len += k - offset;
     }
+    *len = out_len;
     return 0;
 }
 
+int handle_rsa_stream(FILE* in_f, FILE* out_f, const RsaKey* key, int encrypt_mode, const Options* opts) {
+    const size_t k = key->bytes;
+    const size_t data_len = k - RSA_PKCS1_OVERHEAD;
+    uint8_t header[RSA_STREAM_HEADER_SIZE];
 
-int main(int argc, char *argv[]) {
-    if (argc != 10) {
-        print_usage(argv[0]);
-        return 1;
+    // Header: magic, then the modulus size in bytes (big-endian)
+    if (encrypt_mode) {
+        memcpy(header, RSA_STREAM_MAGIC, 4);
+        header[4] = (uint8_t)(k >> 24);
+        header[5] = (uint8_t)(k >> 16);
+        header[6] = (uint8_t)(k >> 8);
+        header[7] = (uint8_t)k;
+        if (write_output(header, RSA_STREAM_HEADER_SIZE, out_f) != RSA_STREAM_HEADER_SIZE) {
+            perror("Failed to write header");
+            return -1;
+        }
+    } else {
+        if (read_input(header, RSA_STREAM_HEADER_SIZE, in_f) != RSA_STREAM_HEADER_SIZE ||
+            memcmp(header, RSA_STREAM_MAGIC, 4) != 0) {
+            fprintf(stderr, "Error: Input is not a multi-block RSA file.\n");
+            return -1;
+        }
+        size_t file_k = ((size_t)header[4] << 24) | ((size_t)header[5] << 16) | ((size_t)header[6] << 8) | header[7];
+        if (file_k != k) {
+            fprintf(stderr, "Error: File was encrypted with a %zu-bit key, not %zu-bit.\n", file_k * 8, k * 8);
+            return -1;
+        }
+    }
+
+    ThreadPool* pool = pool_create(opts->threads);
+    if (!pool) { fprintf(stderr, "Failed to start worker threads.\n"); return -1; }
+
+    const size_t batch_blocks = pool_size(pool) * RSA_STREAM_BLOCKS_PER_THREAD;
+    RsaStream stream = { pool, { key, NULL, NULL, 0 }, encrypt_mode, malloc(batch_blocks * k) };
+    int status = -1;
+    if (!stream.scratch) {
+        fprintf(stderr, "Memory allocation failed\n");
+    } else if (encrypt_mode) {
+        // Chunks of plaintext grow into whole blocks in place
+        status = pipeline_run(in_f, out_f, UINT64_MAX, batch_blocks * data_len, batch_blocks * k,
+                              pipeline_backend(opts), rsa_stream_chunk, &stream);
+    } else {
+        status = pipeline_run(in_f, out_f, UINT64_MAX, batch_blocks * k, batch_blocks * k,
+                              pipeline_backend(opts), rsa_stream_chunk, &stream);
+    }
+    free(stream.scratch);
+    pool_destroy(pool);
+    return status;
+}
+
+
+// Hybrid envelope: a fresh ChaCha20 session key wrapped with RSA, followed by
+// the regular ChaCha20 output (nonce + ciphertext) for the file body.
+int handle_hybrid(FILE* in_f, FILE* out_f, const RsaKey* key, int encrypt_mode, const Options* opts) {
+    const size_t k = key->bytes;
+    uint8_t header[HYBRID_HEADER_SIZE];
+    uint8_t block[RSA_MAX_KEY_BYTES];
+    uint8_t wrapped[RSA_MAX_KEY_BYTES];
+    uint8_t session_key[CHACHA20_KEY_SIZE];
+    size_t out_len;
+    int status;
+
+    if (encrypt_mode) {
+        if (drbg_fill(session_key, CHACHA20_KEY_SIZE) != 0) {
+            perror("Failed to generate session key");
+            return -1;
+        }
+        uint64_t start = stats_start();
+        if (rsa_pad_block(block, k, session_key, CHACHA20_KEY_SIZE) != 0 ||
+            rsa_crypt_block(wrapped, &out_len, block, k, key) != 0) {
+            status = -1;
+            goto done;
+        }
+        stats_modexp(start);
+
+        // Header: magic, 4-byte big-endian modulus size, then the wrapped key
+        memcpy(header, HYBRID_MAGIC, 4);
+        header[4] = (uint8_t)(k >> 24);
+        header[5] = (uint8_t)(k >> 16);
+        header[6] = (uint8_t)(k >> 8);
+        header[7] = (uint8_t)k;
+        if (write_output(header, HYBRID_HEADER_SIZE, out_f) != HYBRID_HEADER_SIZE ||
+            write_output(wrapped, k, out_f) != k) {
+            perror("Failed to write header");
+            status = -1;
+            goto done;
+        }
+    } else {
+        if (read_input(header, HYBRID_HEADER_SIZE, in_f) != HYBRID_HEADER_SIZE ||
+            memcmp(header, HYBRID_MAGIC, 4) != 0) {
+            fprintf(stderr, "Error: Input is not a hybrid-encrypted file.\n");
+            return -1;
+        }
+        size_t file_k = ((size_t)header[4] << 24) | ((size_t)header[5] << 16) | ((size_t)header[6] << 8) | header[7];
+        if (file_k != k) {
+            fprintf(stderr, "Error: File was encrypted with a %zu-bit key, not %zu-bit.\n", file_k * 8, k * 8);
+            return -1;
+        }
+        if (read_input(wrapped, k, in_f) != k) {
+            fprintf(stderr, "Error: Input file too small (missing wrapped key).\n");
+            return -1;
+        }
+
+        size_t offset;
+        uint64_t start = stats_start();
+        if (rsa_crypt_block(block, &out_len, wrapped, k, key) != 0) {
+            status = -1;
+            goto done;
+        }
+        stats_modexp(start);
+        if (rsa_unpad_block(block, out_len, &offset) != 0) {
+            status = -1;
+            goto done;
+        }
+        if (out_len - offset != CHACHA20_KEY_SIZE) {
+            fprintf(stderr, "Error: Wrapped session key has the wrong size.\n");
+            status = -1;
+            goto done;
+        }
+        memcpy(session_key, block + offset, CHACHA20_KEY_SIZE);
+    }
+
+    status = handle_chacha20(in_f, out_f, session_key, encrypt_mode, opts);
+
+done:
+    memset(session_key, 0, sizeof(session_key));
+    memset(block, 0, sizeof(block));
+    return status;
+}
+
+
+// Everything about a run that is the same for each of its files
+typedef struct {
+    const char* alg;
+    int encrypt_mode;
+    const uint8_t* key;    // Key file contents, for the symmetric algorithms
+    const RsaKey* rsa_key; // Parsed once, for the RSA-based algorithms
+    Options opts;
+} Job;
+
+// Runs the job on one input/output pair ("-" for stdin/stdout).
+// Returns 0 on success, -1 on failure.
+static int process_file(const Job* job, const char* infile, const char* outfile) {
+    FILE* in_f = strcmp(infile, "-") == 0 ? stdin : fopen(infile, "rb");
+    if (!in_f) { perror(infile); return -1; }
+    // Opened for reading too, so the output can be memory-mapped. A resumed
+    // container encryption keeps what is already there.
+    FILE* out_f = strcmp(outfile, "-") == 0 ? stdout : job->opts.resume ? fopen(outfile, "r+b") : NULL;
+    if (!out_f) out_f = fopen(outfile, "w+b");
+    if (!out_f) { perror(outfile); if (in_f != stdin) fclose(in_f); return -1; }
+
+    int status;
+    const char* alg = job->alg;
+    if (strcmp(alg, "tea") == 0) {
+        status = handle_tea(in_f, out_f, job->key, job->encrypt_mode, &job->opts);
+    } else if (strcmp(alg, "tea-ctr") == 0) {
+        status = handle_tea_ctr(in_f, out_f, job->key, job->encrypt_mode, &job->opts);
+    } else if (strcmp(alg, "chacha20") == 0) {
+        status = handle_chacha20(in_f, out_f, job->key, job->encrypt_mode, &job->opts);
+    } else if (strcmp(alg, "xchacha20") == 0) {
+        status = handle_xchacha20(in_f, out_f, job->key, job->encrypt_mode, &job->opts);
+    } else if (strcmp(alg, "chacha20-poly1305") == 0) {
+        status = handle_chacha20_poly1305(in_f, out_f, job->key, job->encrypt_mode, &job->opts);
+    } else if (strcmp(alg, "rsa") == 0) {
+        status = handle_rsa(in_f, out_f, job->rsa_key, job->encrypt_mode);
+    } else if (strcmp(alg, "rsa-stream") == 0) {
+        status = handle_rsa_stream(in_f, out_f, job->rsa_key, job->encrypt_mode, &job->opts);
+    } else {
+        status = handle_hybrid(in_f, out_f, job->rsa_key, job->encrypt_mode, &job->opts);
+    }
+
+    if (status == 0 && fflush(out_f) != 0) { perror(outfile); status = -1; }
+    if (in_f != stdin) fclose(in_f);
+    if (out_f != stdout && fclose(out_f) != 0 && status == 0) { perror(outfile); status = -1; }
+    return status;
+}
+
+// One manifest line
+typedef struct {
+    char* infile;
+    char* outfile;
+    uint64_t size; // Input size, for scheduling and the throughput report
+    int status;
+} BatchEntry;
+
+typedef struct {
+    const Job* job;
+    BatchEntry* entries;
+} BatchRun;
+
+// Manifest format: one "<infile> <outfile>" pair per line. The two paths are
+// separated by a tab if the line has one (so paths may contain spaces), else
+// by spaces. Blank lines and lines starting with '#' are skipped.
+// Returns 0 on success, -1 on failure; *entries must be freed with free_manifest().
+static int read_manifest(const char* path, BatchEntry** entries, size_t* count) {
+    *entries = NULL;
+    *count = 0;
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+
+    size_t capacity = 0, line_no = 0;
+    char* line = NULL;
+    size_t line_cap = 0;
+    int status = 0;
+    while (getline(&line, &line_cap, f) != -1) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char* in = line + strspn(line, " \t");
+        if (*in == '\0' || *in == '#') continue;
+
+        char* sep = strchr(in, '\t');
+        if (!sep) sep = strchr(in, ' ');
+        char* out = sep ? sep + strspn(sep, " \t") : NULL;
+        if (!sep || *out == '\0') {
+            fprintf(stderr, "%s:%zu: expected \"<infile> <outfile>\"\n", path, line_no);
+            status = -1;
+            break;
+        }
+        *sep = '\0';
+        for (char* end = in + strlen(in); end > in && end[-1] == ' '; ) *--end = '\0';
+        for (char* end = out + strlen(out); end > out && (end[-1] == ' ' || end[-1] == '\t'); ) *--end = '\0';
+        if (strcmp(in, "-") == 0 || strcmp(out, "-") == 0) {
+            fprintf(stderr, "%s:%zu: stdin/stdout can't be used in a batch\n", path, line_no);
+            status = -1;
+            break;
+        }
+
+        if (*count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            BatchEntry* grown = realloc(*entries, capacity * sizeof(BatchEntry));
+            if (!grown) { fprintf(stderr, "Memory allocation failed\n"); status = -1; break; }
+            *entries = grown;
+        }
+        BatchEntry* e = &(*entries)[*count];
+        e->infile = strdup(in);
+        e->outfile = strdup(out);
+        e->size = 0;
+        e->status = 0;
+        (*count)++;
+        if (!e->infile || !e->outfile) { fprintf(stderr, "Memory allocation failed\n"); status = -1; break; }
     }
+    if (status == 0 && ferror(f)) { perror(path); status = -1; }
+    free(line);
+    if (f != stdin) fclose(f);
+    return status;
+}
+
+static void free_manifest(BatchEntry* entries, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        free(entries[i].infile);
+        free(entries[i].outfile);
+    }
+    free(entries);
+}
+
+// Largest input first, so a big file picked up last can't leave the other threads idle
+static int compare_entry_size(const void* a, const void* b) {
+    uint64_t sa = ((const BatchEntry*)a)->size, sb = ((const BatchEntry*)b)->size;
+    return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
+
+static void batch_task(void* arg, size_t index) {
+    BatchRun* run = arg;
+    BatchEntry* e = &run->entries[index];
+    e->status = process_file(run->job, e->infile, e->outfile);
+}
 
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Processes every file of the manifest with the key loaded once. Files are
+// spread over the thread pool, whose workers each claim the next file as soon
+// as they are done with one; each file then runs single-threaded. With fewer
+// files than threads, files run one after another, each using every thread.
+// Prints the aggregate throughput. Returns 0 if every file succeeded.
+static int run_batch(const Job* job, const char* manifest) {
+    BatchEntry* entries = NULL;
+    size_t count = 0;
+    if (read_manifest(manifest, &entries, &count) != 0) {
+        free_manifest(entries, count);
+        return -1;
+    }
+
+    uint64_t total_bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        struct stat st;
+        if (stat(entries[i].infile, &st) == 0) entries[i].size = (uint64_t)st.st_size;
+        total_bytes += entries[i].size;
+    }
+    qsort(entries, count, sizeof(BatchEntry), compare_entry_size);
+
+    size_t threads = job->opts.threads ? job->opts.threads : pool_default_threads();
+    double start = now_seconds();
+    if (count >= threads && threads > 1) {
+        ThreadPool* pool = pool_create(threads);
+        if (!pool) {
+            fprintf(stderr, "Failed to start worker threads.\n");
+            free_manifest(entries, count);
+            return -1;
+        }
+        Job file_job = *job;
+        file_job.opts.threads = 1;
+        BatchRun run = { &file_job, entries };
+        pool_run(pool, count, batch_task, &run);
+        pool_destroy(pool);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            entries[i].status = process_file(job, entries[i].infile, entries[i].outfile);
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    size_t failed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (entries[i].status != 0) {
+            fprintf(stderr, "Failed: %s -> %s\n", entries[i].infile, entries[i].outfile);
+            failed++;
+        }
+    }
+    if (elapsed <= 0) elapsed = 1e-9;
+    printf("Batch: %zu files (%zu failed), %.1f MB in %.3f s: %.1f MB/s, %.1f files/s\n",
+           count, failed, total_bytes / 1e6, elapsed, total_bytes / 1e6 / elapsed, count / elapsed);
+    free_manifest(entries, count);
+    return failed == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
     int encrypt_mode = -1;
-    char* alg = NULL, *infile = NULL, *keyfile = NULL, *outfile = NULL;
+    char* alg = NULL, *infile = NULL, *keyfile = NULL, *outfile = NULL, *manifest = NULL, *stats_json = NULL;
+    int stats_text = 0, record_size_set = 0;
+    Options opts = { 0, IO_MMAP, 0, 0, UINT64_MAX, 0, CONTAINER_DEFAULT_RECORD_SIZE, 0, 0 };
 
-    for (int i = 1; i < argc; i += 2) {
-        if (strcmp(argv[i], "-e") == 0) { encrypt_mode = 1; i--; }
-        else if (strcmp(argv[i], "-d") == 0) { encrypt_mode = 0; i--; }
-        else if (strcmp(argv[i], "-a") == 0) { alg = argv[i+1]; }
-        else if (strcmp(argv[i], "-i") == 0) { infile = argv[i+1]; }
-        else if (strcmp(argv[i], "-k") == 0) { keyfile = argv[i+1]; }
-        else if (strcmp(argv[i], "-o") == 0) { outfile = argv[i+1]; }
+    for (int i = 1; i < argc; ++i) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "-e") == 0) { encrypt_mode = 1; }
+        else if (strcmp(argv[i], "-d") == 0) { encrypt_mode = 0; }
+        else if (value && strcmp(argv[i], "-a") == 0) { alg = argv[++i]; }
+        else if (value && strcmp(argv[i], "-i") == 0) { infile = argv[++i]; }
+        else if (value && strcmp(argv[i], "-k") == 0) { keyfile = argv[++i]; }
+        else if (value && strcmp(argv[i], "-o") == 0) { outfile = argv[++i]; }
+        else if (value && strcmp(argv[i], "--batch") == 0) { manifest = argv[++i]; }
+        else if (strcmp(argv[i], "--stats") == 0) { stats_text = 1; }
+        else if (strcmp(argv[i], "--container") == 0) { opts.container = 1; }
+        else if (strcmp(argv[i], "--no-index") == 0) { opts.no_index = 1; }
+        else if (strcmp(argv[i], "--resume") == 0) { opts.resume = 1; }
+        else if (value && strcmp(argv[i], "--stats-json") == 0) { stats_json = argv[++i]; }
+        else if (value && strcmp(argv[i], "-j") == 0) {
+            char* end;
+            long threads = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || threads < 1) {
+                fprintf(stderr, "Invalid thread count: %s\n", argv[i]);
+                return 1;
+            }
+            opts.threads = (size_t)threads;
+        }
+        else if (value && strcmp(argv[i], "--record-size") == 0) {
+            char* end;
+            unsigned long n = strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || argv[i][0] == '-' || n == 0 || n % 64 != 0 || n > CONTAINER_MAX_RECORD_SIZE) {
+                fprintf(stderr, "Invalid record size: %s (must be a multiple of 64, at most %d)\n", argv[i], CONTAINER_MAX_RECORD_SIZE);
+                return 1;
+            }
+            opts.record_size = (uint32_t)n;
+            record_size_set = 1;
+        }
+        else if (value && strcmp(argv[i], "--io") == 0) {
+            ++i;
+            if (strcmp(argv[i], "mmap") == 0) opts.io = IO_MMAP;
+            else if (strcmp(argv[i], "uring") == 0) opts.io = IO_URING;
+            else if (strcmp(argv[i], "stdio") == 0) opts.io = IO_STDIO;
+            else {
+                fprintf(stderr, "Unknown I/O backend: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (value && (strcmp(argv[i], "--offset") == 0 || strcmp(argv[i], "--length") == 0)) {
+            const char* name = argv[i++];
+            char* end;
+            errno = 0;
+            unsigned long long n = strtoull(argv[i], &end, 10);
+            if (*end != '\0' || argv[i][0] == '-' || argv[i][0] == '\0' || errno == ERANGE) {
+                fprintf(stderr, "Invalid %s value: %s\n", name, argv[i]);
+                return 1;
+            }
+            if (strcmp(name, "--offset") == 0) opts.offset = n;
+            else opts.length = n;
+            opts.has_range = 1;
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
     }
     
-    if (encrypt_mode == -1 || !alg || !infile || !keyfile || !outfile) {
+    if (encrypt_mode == -1 || !alg || !keyfile || (manifest ? infile || outfile : !infile || !outfile)) {
         print_usage(argv[0]);
         return 1;
     }
+    if (opts.has_range && (encrypt_mode ||
+        (strcmp(alg, "tea") != 0 && strcmp(alg, "tea-ctr") != 0 && strcmp(alg, "chacha20") != 0 &&
+         strcmp(alg, "xchacha20") != 0 && strcmp(alg, "hybrid") != 0))) {
+        fprintf(stderr, "--offset/--length only apply to tea, tea-ctr, chacha20, xchacha20 and hybrid decryption.\n");
+        return 1;
+    }
+    if (opts.container && strcmp(alg, "tea") != 0 && strcmp(alg, "chacha20") != 0 && strcmp(alg, "hybrid") != 0) {
+        fprintf(stderr, "--container only applies to tea, chacha20 and hybrid.\n");
+        return 1;
+    }
+    if (!opts.container && (record_size_set || opts.no_index || opts.resume)) {
+        fprintf(stderr, "--record-size, --no-index and --resume need --container.\n");
+        return 1;
+    }
+    if (opts.resume && (!encrypt_mode || strcmp(alg, "hybrid") == 0 ||
+        (infile && strcmp(infile, "-") == 0) || (outfile && strcmp(outfile, "-") == 0))) {
+        fprintf(stderr, "--resume only applies to tea and chacha20 container encryption between regular files.\n");
+        return 1;
+    }
+    if (opts.has_range && opts.offset > (uint64_t)INT64_MAX) {
+        fprintf(stderr, "Offset out of range.\n");
+        return 1;
+    }
 
-    FILE* in_f = fopen(infile, "rb");
-    if (!in_f) { perror(infile); return 1; }
-    
+    // Read the key, once for however many files there are
     FILE* key_f = fopen(keyfile, "rb");
-    if (!key_f) { perror(keyfile); fclose(in_f); return 1; }
-    
-    FILE* out_f = fopen(outfile, "wb");
-    if (!out_f) { perror(outfile); fclose(in_f); fclose(key_f); return 1; }
-
-    int status = 0;
-    
-    // Read the key
+    if (!key_f) { perror(keyfile); return 1; }
     fseek(key_f, 0, SEEK_END);
     long key_size = ftell(key_f);
     fseek(key_f, 0, SEEK_SET);
-    uint8_t* key_data = malloc(key_size);
-    if (!key_data) { fprintf(stderr, "Memory allocation failed\n"); status = 1; goto cleanup; }
-    if (fread(key_data, 1, key_size, key_f) != (size_t)key_size) {
-        fprintf(stderr, "Failed to read key file.\n"); status = 1; goto cleanup;
+    uint8_t* key_data = malloc(key_size > 0 ? key_size : 1);
+    int status = 0;
+    if (!key_data) {
+        fprintf(stderr, "Memory allocation failed\n");
+        status = 1;
+    } else if (key_size < 0 || fread(key_data, 1, key_size, key_f) != (size_t)key_size) {
+        fprintf(stderr, "Failed to read key file.\n");
+        status = 1;
     }
+    fclose(key_f);
+    if (status != 0) { free(key_data); return status; }
 
-    // Dispatch to correct handler
-    if (strcmp(alg, "tea") == 0) {
-        if (key_size < TEA_KEY_SIZE) { fprintf(stderr, "TEA key must be %d bytes.\n", TEA_KEY_SIZE); status=1; goto cleanup; }
-        status = handle_tea(in_f, out_f, key_data, encrypt_mode);
-    } else if (strcmp(alg, "chacha20") == 0) {
-        if (key_size < CHACHA20_KEY_SIZE) { fprintf(stderr, "ChaCha20 key must be %d bytes.\n", CHACHA20_KEY_SIZE); status=1; goto cleanup; }
-        status = handle_chacha20(in_f, out_f, key_data, encrypt_mode);
-    } else if (strcmp(alg, "rsa") == 0) {
-        if (key_size < 2 * RSA_KEY_BYTES) { fprintf(stderr, "RSA key file must be %d bytes.\n", 2*RSA_KEY_BYTES); status=1; goto cleanup; }
-        status = handle_rsa(in_f, out_f, key_data, encrypt_mode);
+    // Check it against the algorithm. RSA keys are parsed here, along with their Montgomery contexts.
+    RsaKey rsa_key;
+    Job job = { alg, encrypt_mode, key_data, &rsa_key, opts };
+    if (strcmp(alg, "tea") == 0 || strcmp(alg, "tea-ctr") == 0) {
+        if (key_size < TEA_KEY_SIZE) { fprintf(stderr, "TEA key must be %d bytes.\n", TEA_KEY_SIZE); status = 1; }
+    } else if (strcmp(alg, "chacha20") == 0 || strcmp(alg, "xchacha20") == 0 || strcmp(alg, "chacha20-poly1305") == 0) {
+        if (key_size < CHACHA20_KEY_SIZE) { fprintf(stderr, "ChaCha20 key must be %d bytes.\n", CHACHA20_KEY_SIZE); status = 1; }
+    } else if (strcmp(alg, "rsa") == 0 || strcmp(alg, "rsa-stream") == 0 || strcmp(alg, "hybrid") == 0) {
+        // Key file format: modulus, exponent, then optional CRT parameters (see rsa.h)
+        if (rsa_load_key(&rsa_key, key_data, (size_t)key_size) != 0) {
+            fprintf(stderr, "Error: %s is not a valid %d to %d-bit RSA key file.\n",
+                    keyfile, RSA_MIN_KEY_BYTES * 8, RSA_MAX_KEY_BYTES * 8);
+            status = 1;
+        }
     } else {
         fprintf(stderr, "Unknown algorithm: %s\n", alg);
         status = 1;
     }
-    
+    if (status != 0) { free(key_data); return status; }
+
+    // The status message must not end up in the data stream
+    FILE* msg_f = outfile && strcmp(outfile, "-") == 0 ? stderr : stdout;
+    stats_enabled = stats_text || stats_json;
+    uint64_t wall_start = stats_start();
+    if (manifest) {
+        status = run_batch(&job, manifest);
+    } else {
+        status = process_file(&job, infile, outfile);
+    }
+    if (stats_enabled) {
+        uint64_t wall_ns = stats_now_ns() - wall_start;
+        if (stats_text) stats_print(stderr, wall_ns);
+        if (stats_json && strcmp(stats_json, "-") == 0) {
+            stats_print_json(msg_f, wall_ns);
+        } else if (stats_json) {
+            FILE* json_f = fopen(stats_json, "w");
+            if (!json_f) {
+                perror(stats_json);
+            } else {
+                stats_print_json(json_f, wall_ns);
+                fclose(json_f);
+            }
+        }
+    }
     if (status == 0) {
-        printf("Operation completed successfully.\n");
+        fprintf(msg_f, "Operation completed successfully.\n");
     } else {
         fprintf(stderr, "An error occurred during the operation.\n");
     }
 
-cleanup:
-    if (key_data) free(key_data);
-    fclose(in_f);
-    fclose(key_f);
-    fclose(out_f);
+    memset(&rsa_key, 0, sizeof(rsa_key));
+    free(key_data);
     return status;
-}
\ No newline at end of file
+}
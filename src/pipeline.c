@@ -0,0 +1,479 @@
+#define _GNU_SOURCE
+#include "pipeline.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// io_uring is driven through the raw system calls, so no liburing is needed.
+// Building against headers without it just leaves the thread backend.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define PIPELINE_HAVE_URING 1
+#endif
+#endif
+
+typedef enum {
+    SLOT_FREE,     // Ready for the next read
+    SLOT_READING,  // io_uring read in flight
+    SLOT_FULL,     // Input ready for processing
+    SLOT_DONE,     // Output ready for writing
+    SLOT_WRITING,  // io_uring write in flight
+} SlotState;
+
+typedef struct {
+    uint8_t* buf;
+    size_t len;       // Bytes of data in buf
+    int last;         // Final chunk of the stream
+    SlotState state;
+#ifdef PIPELINE_HAVE_URING
+    uint64_t offset;  // File offset of the current request
+    size_t done;      // Bytes of the current request already transferred
+    struct iovec iov;
+#endif
+} Slot;
+
+typedef struct {
+    Slot slots[PIPELINE_DEPTH];
+    FILE* in_f;
+    FILE* out_f;
+    uint64_t remaining;  // Input bytes still allowed
+    size_t chunk_size;
+    pipeline_fn fn;
+    void* ctx;
+
+    // Thread backend
+    pthread_mutex_t lock;
+    pthread_cond_t changed;  // Broadcast on every slot state change and on failure
+    int failed;
+} Pipeline;
+
+// --- Thread backend ---
+
+// Waits until the slot reaches the state. Called with the lock held.
+// Returns -1 if the pipeline failed in the meantime.
+static int wait_for(Pipeline* p, Slot* s, SlotState state) {
+    while (s->state != state && !p->failed) pthread_cond_wait(&p->changed, &p->lock);
+    return p->failed ? -1 : 0;
+}
+
+static int wait_for_slot(Pipeline* p, Slot* s, SlotState state) {
+    pthread_mutex_lock(&p->lock);
+    int status = wait_for(p, s, state);
+    pthread_mutex_unlock(&p->lock);
+    return status;
+}
+
+static void set_state(Pipeline* p, Slot* s, SlotState state) {
+    pthread_mutex_lock(&p->lock);
+    s->state = state;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void set_failed(Pipeline* p) {
+    pthread_mutex_lock(&p->lock);
+    p->failed = 1;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Fills slots in order. Each chunk is handed on only once the next read shows
+// whether it is the last one, so the final chunk is never an empty tail.
+static void* reader_main(void* arg) {
+    Pipeline* p = arg;
+    Slot* pending = NULL;
+    for (size_t i = 0; ; i = (i + 1) % PIPELINE_DEPTH) {
+        Slot* s = &p->slots[i];
+        if (wait_for_slot(p, s, SLOT_FREE) != 0) return NULL;
+
+        size_t want = p->remaining < p->chunk_size ? (size_t)p->remaining : p->chunk_size;
+        uint64_t start = stats_start();
+        s->len = want > 0 ? fread(s->buf, 1, want, p->in_f) : 0;
+        stats_stop(STAT_READ, start);
+        stats_add(STAT_BYTES_READ, s->len);
+        s->last = 0;
+        p->remaining -= s->len;
+        if (ferror(p->in_f)) {
+            perror("File read error");
+            set_failed(p);
+            return NULL;
+        }
+        // fread only comes back short at the end of the input
+        int at_end = s->len < want || p->remaining == 0;
+
+        if (s->len == 0 && pending) {
+            pending->last = 1;
+            set_state(p, pending, SLOT_FULL);
+            return NULL;
+        }
+        if (pending) set_state(p, pending, SLOT_FULL);
+        if (at_end) {
+            s->last = 1;
+            set_state(p, s, SLOT_FULL);
+            return NULL;
+        }
+        pending = s;
+    }
+}
+
+static void* writer_main(void* arg) {
+    Pipeline* p = arg;
+    for (size_t i = 0; ; i = (i + 1) % PIPELINE_DEPTH) {
+        Slot* s = &p->slots[i];
+        if (wait_for_slot(p, s, SLOT_DONE) != 0) return NULL;
+
+        uint64_t start = stats_start();
+        if (s->len > 0 && fwrite(s->buf, 1, s->len, p->out_f) != s->len) {
+            perror("File write error");
+            set_failed(p);
+            return NULL;
+        }
+        stats_stop(STAT_WRITE, start);
+        stats_add(STAT_BYTES_WRITTEN, s->len);
+        int last = s->last;
+        set_state(p, s, SLOT_FREE);
+        if (last) return NULL;
+    }
+}
+
+static int run_threads(Pipeline* p) {
+    pthread_t reader, writer;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->changed, NULL);
+
+    int have_reader = pthread_create(&reader, NULL, reader_main, p) == 0;
+    int have_writer = have_reader && pthread_create(&writer, NULL, writer_main, p) == 0;
+    if (!have_writer) {
+        fprintf(stderr, "Failed to start I/O threads.\n");
+        set_failed(p);
+    }
+
+    for (size_t i = 0; have_writer; i = (i + 1) % PIPELINE_DEPTH) {
+        Slot* s = &p->slots[i];
+        uint64_t start = stats_start();
+        if (wait_for_slot(p, s, SLOT_FULL) != 0) break;
+        stats_stop(STAT_IO_WAIT, start);
+        int last = s->last;
+        start = stats_start();
+        if (p->fn(p->ctx, s->buf, &s->len, last) != 0) {
+            set_failed(p);
+            break;
+        }
+        stats_stop(STAT_CRYPTO, start);
+        set_state(p, s, SLOT_DONE);
+        if (last) break;
+    }
+
+    if (have_reader) pthread_join(reader, NULL);
+    if (have_writer) pthread_join(writer, NULL);
+    pthread_cond_destroy(&p->changed);
+    pthread_mutex_destroy(&p->lock);
+    return p->failed ? -1 : 0;
+}
+
+// --- io_uring backend ---
+
+#ifdef PIPELINE_HAVE_URING
+
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_ring;
+    size_t sq_ring_len;
+    void* cq_ring;       // Same as sq_ring on kernels with IORING_FEAT_SINGLE_MMAP
+    size_t cq_ring_len;
+    size_t sqes_len;
+    unsigned to_submit;  // Queued entries not yet passed to the kernel
+} Uring;
+
+static void uring_free(Uring* r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_len);
+    if (r->cq_ring && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_len);
+    if (r->sq_ring) munmap(r->sq_ring, r->sq_ring_len);
+    close(r->fd);
+}
+
+static int uring_init(Uring* r, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(r, 0, sizeof(*r));
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (r->fd < 0) return -1;
+
+    r->entries = params.sq_entries;
+    r->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    r->cq_ring_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_len > r->sq_ring_len) r->sq_ring_len = r->cq_ring_len;
+        r->cq_ring_len = r->sq_ring_len;
+    }
+    r->sq_ring = mmap(NULL, r->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) { r->sq_ring = NULL; uring_free(r); return -1; }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) { r->cq_ring = NULL; uring_free(r); return -1; }
+    }
+    r->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) { r->sqes = NULL; uring_free(r); return -1; }
+
+    char* sq = r->sq_ring;
+    char* cq = r->cq_ring;
+    r->sq_head = (unsigned*)(sq + params.sq_off.head);
+    r->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    r->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + params.sq_off.array);
+    r->cq_head = (unsigned*)(cq + params.cq_off.head);
+    r->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    r->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+// Queues a read or write of the rest of the slot's current request.
+// The ring has room for a request per slot, so it never fills up.
+static void uring_queue(Uring* r, Slot* s, size_t index, int fd, uint8_t opcode) {
+    unsigned tail = *r->sq_tail;
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe* sqe = &r->sqes[idx];
+
+    s->iov.iov_base = s->buf + s->done;
+    s->iov.iov_len = s->len - s->done;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)&s->iov;
+    sqe->len = 1;
+    sqe->off = s->offset + s->done;
+    sqe->user_data = index;
+
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->to_submit++;
+}
+
+// Submits queued requests and, if wait is set, blocks until one completes
+static int uring_enter(Uring* r, int wait) {
+    for (;;) {
+        long rc = syscall(__NR_io_uring_enter, r->fd, r->to_submit, wait ? 1 : 0,
+                          wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (rc >= 0) {
+            r->to_submit -= (unsigned)rc;
+            return 0;
+        }
+        if (errno != EINTR) return -1;
+    }
+}
+
+typedef struct {
+    Uring ring;
+    int in_fd;
+    int out_fd;
+    unsigned in_flight;
+    uint64_t writes_done;  // Chunks completely written
+    int failed;
+} UringState;
+
+// Handles every available completion: finished reads become FULL, finished
+// writes FREE, and short transfers are queued again for the remainder.
+static void uring_reap(Pipeline* p, UringState* u) {
+    Uring* r = &u->ring;
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        struct io_uring_cqe* cqe = &r->cqes[head & *r->cq_mask];
+        size_t index = (size_t)cqe->user_data;
+        Slot* s = &p->slots[index];
+        int reading = s->state == SLOT_READING;
+        u->in_flight--;
+
+        if (cqe->res <= 0) {
+            if (!u->failed) {
+                if (cqe->res == 0) {
+                    fprintf(stderr, "File read error: input ended early\n");
+                } else {
+                    errno = -cqe->res;
+                    perror(reading ? "File read error" : "File write error");
+                }
+            }
+            u->failed = 1;
+            continue;
+        }
+        s->done += (size_t)cqe->res;
+        if (s->done < s->len) {
+            if (!u->failed) {
+                uring_queue(r, s, index, reading ? u->in_fd : u->out_fd, reading ? IORING_OP_READV : IORING_OP_WRITEV);
+                u->in_flight++;
+            }
+        } else if (reading) {
+            s->state = SLOT_FULL;
+            stats_add(STAT_BYTES_READ, s->len);
+        } else {
+            s->state = SLOT_FREE;
+            u->writes_done++;
+            stats_add(STAT_BYTES_WRITTEN, s->len);
+        }
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+}
+
+// Runs the pipeline on one thread: the kernel does the reads and writes while
+// the chunks are processed here. Returns 1 if io_uring can't be used for these
+// streams, so the caller falls back to the thread backend.
+static int run_uring(Pipeline* p) {
+    UringState u;
+    struct stat in_st, out_st;
+    u.in_fd = fileno(p->in_f);
+    u.out_fd = fileno(p->out_f);
+    if (u.in_fd < 0 || u.out_fd < 0 || fstat(u.in_fd, &in_st) != 0 || fstat(u.out_fd, &out_st) != 0 ||
+        !S_ISREG(in_st.st_mode) || !S_ISREG(out_st.st_mode)) {
+        return 1;
+    }
+    // Requests use explicit offsets, so everything written through stdio so far has to be in the file
+    if (fflush(p->out_f) != 0) return 1;
+    off_t in_pos = ftello(p->in_f);
+    off_t out_pos = ftello(p->out_f);
+    if (in_pos < 0 || out_pos < 0) return 1;
+    if (uring_init(&u.ring, 2 * PIPELINE_DEPTH) != 0) return 1;
+    u.in_flight = 0;
+    u.writes_done = 0;
+    u.failed = 0;
+
+    uint64_t total = in_st.st_size > in_pos ? (uint64_t)(in_st.st_size - in_pos) : 0;
+    if (total > p->remaining) total = p->remaining;
+    // An empty input is still one (empty) final chunk for the callback
+    uint64_t chunks = total > 0 ? (total + p->chunk_size - 1) / p->chunk_size : 1;
+    uint64_t next_read = 0, next_proc = 0;
+    uint64_t out_off = (uint64_t)out_pos;
+
+    while (!u.failed && u.writes_done < chunks) {
+        // Keep reads going for every free slot ahead of the processing position
+        while (next_read < chunks && next_read < next_proc + PIPELINE_DEPTH) {
+            size_t index = next_read % PIPELINE_DEPTH;
+            Slot* s = &p->slots[index];
+            if (s->state != SLOT_FREE) break;
+            uint64_t start = next_read * p->chunk_size;
+            s->len = total - start < p->chunk_size ? (size_t)(total - start) : p->chunk_size;
+            s->last = next_read == chunks - 1;
+            s->offset = (uint64_t)in_pos + start;
+            s->done = 0;
+            if (s->len == 0) {
+                s->state = SLOT_FULL;
+            } else {
+                s->state = SLOT_READING;
+                uring_queue(&u.ring, s, index, u.in_fd, IORING_OP_READV);
+                u.in_flight++;
+            }
+            next_read++;
+        }
+
+        size_t index = next_proc % PIPELINE_DEPTH;
+        Slot* s = &p->slots[index];
+        if (next_proc < chunks && s->state == SLOT_FULL) {
+            // Hand the queued requests to the kernel before spending time on the chunk
+            if (u.ring.to_submit > 0 && uring_enter(&u.ring, 0) != 0) {
+                perror("io_uring submit failed");
+                u.failed = 1;
+                break;
+            }
+            uint64_t start = stats_start();
+            if (p->fn(p->ctx, s->buf, &s->len, s->last) != 0) {
+                u.failed = 1;
+                break;
+            }
+            stats_stop(STAT_CRYPTO, start);
+            s->offset = out_off;
+            s->done = 0;
+            out_off += s->len;
+            if (s->len == 0) {
+                s->state = SLOT_FREE;
+                u.writes_done++;
+            } else {
+                s->state = SLOT_WRITING;
+                uring_queue(&u.ring, s, index, u.out_fd, IORING_OP_WRITEV);
+                u.in_flight++;
+            }
+            next_proc++;
+            continue;
+        }
+
+        uint64_t start = stats_start();
+        if (uring_enter(&u.ring, 1) != 0) {
+            perror("io_uring wait failed");
+            u.failed = 1;
+            break;
+        }
+        stats_stop(STAT_IO_WAIT, start);
+        uring_reap(p, &u);
+    }
+
+    // Buffers can only be released once the kernel is done with them
+    while (u.in_flight > 0) {
+        if (uring_enter(&u.ring, 1) != 0) break;
+        uring_reap(p, &u);
+    }
+    uring_free(&u.ring);
+
+    if (u.failed) return -1;
+    if (fseeko(p->in_f, in_pos + (off_t)total, SEEK_SET) != 0 ||
+        fseeko(p->out_f, (off_t)out_off, SEEK_SET) != 0) {
+        perror("Seek error");
+        return -1;
+    }
+    return 0;
+}
+
+#endif // PIPELINE_HAVE_URING
+
+int pipeline_run(FILE* in_f, FILE* out_f, uint64_t max_len, size_t chunk_size, size_t capacity,
+                 PipelineBackend backend, pipeline_fn fn, void* ctx) {
+    Pipeline p;
+    memset(&p, 0, sizeof(p));
+    p.in_f = in_f;
+    p.out_f = out_f;
+    p.remaining = max_len;
+    p.chunk_size = chunk_size;
+    p.fn = fn;
+    p.ctx = ctx;
+
+    int status = 0;
+    for (size_t i = 0; i < PIPELINE_DEPTH; ++i) {
+        p.slots[i].buf = malloc(capacity);
+        if (!p.slots[i].buf) status = -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+    } else {
+        status = 1;
+#ifdef PIPELINE_HAVE_URING
+        if (backend == PIPELINE_URING) status = run_uring(&p);
+#else
+        (void)backend;
+#endif
+        if (status == 1) status = run_threads(&p);
+    }
+
+    for (size_t i = 0; i < PIPELINE_DEPTH; ++i) free(p.slots[i].buf);
+    return status;
+}
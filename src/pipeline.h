@@ -0,0 +1,33 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// A read -> process -> write pipeline over a ring of PIPELINE_DEPTH buffers.
+// While the caller processes chunk i, the reads of the following chunks and
+// the writes of the previous ones are already in flight, so disk and CPU
+// overlap instead of taking turns.
+#define PIPELINE_DEPTH 4
+
+typedef enum {
+    PIPELINE_URING,   // io_uring for regular files when the kernel has it, else threads
+    PIPELINE_THREADS, // A reader and a writer thread over stdio (works for pipes)
+} PipelineBackend;
+
+// Processing callback, run on the calling thread for every chunk in order.
+// On entry *len is the number of input bytes in buf; on return it is the number
+// of output bytes the callback left in buf (at most the capacity passed to
+// pipeline_run()). last is set for the final chunk, which is only empty when the
+// whole input is. Returns 0, or -1 to stop the pipeline.
+typedef int (*pipeline_fn)(void* ctx, uint8_t* buf, size_t* len, int last);
+
+// Streams the rest of in_f (at most max_len bytes) through fn into out_f, in
+// chunks of chunk_size input bytes held in buffers of capacity bytes.
+// Both streams are left positioned after the data they carried.
+// Returns 0 on success, -1 on an I/O error or when fn fails.
+int pipeline_run(FILE* in_f, FILE* out_f, uint64_t max_len, size_t chunk_size, size_t capacity,
+                 PipelineBackend backend, pipeline_fn fn, void* ctx);
+
+#endif // PIPELINE_H
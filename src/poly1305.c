@@ -0,0 +1,264 @@
+#include "poly1305.h"
+#include "poly1305_simd.h"
+#include "dispatch.h"
+#include <string.h>
+
+// Poly1305 (RFC 8439) in 64-bit limbs: h and r are split 44/44/42 bits, so
+// each block is nine 64x64->128-bit multiplies and the reduction mod 2^130 - 5
+// folds the high limbs back in with a multiply by 5.
+
+__extension__ typedef unsigned __int128 poly1305_u128;
+
+#define MASK44 0xfffffffffffULL
+#define MASK42 0x3ffffffffffULL
+#define MASK26 0x3ffffffu
+#define HIBIT (1ULL << 40) // 2^128 in the top limb, appended to every full block
+
+static uint64_t load64_le(const uint8_t *p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static void store64_le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// h = h * r, partially reduced: h[0] < 2^44, h[1] may carry a bit past 2^44
+static void poly1305_mul(uint64_t h[3], const uint64_t r[3]) {
+    const uint64_t s1 = r[1] * (5 << 2), s2 = r[2] * (5 << 2);
+    poly1305_u128 d0 = (poly1305_u128)h[0] * r[0] + (poly1305_u128)h[1] * s2 + (poly1305_u128)h[2] * s1;
+    poly1305_u128 d1 = (poly1305_u128)h[0] * r[1] + (poly1305_u128)h[1] * r[0] + (poly1305_u128)h[2] * s2;
+    poly1305_u128 d2 = (poly1305_u128)h[0] * r[2] + (poly1305_u128)h[1] * r[1] + (poly1305_u128)h[2] * r[0];
+
+    uint64_t c = (uint64_t)(d0 >> 44);
+    h[0] = (uint64_t)d0 & MASK44;
+    d1 += c;
+    c = (uint64_t)(d1 >> 44);
+    h[1] = (uint64_t)d1 & MASK44;
+    d2 += c;
+    c = (uint64_t)(d2 >> 42);
+    h[2] = (uint64_t)d2 & MASK42;
+    h[0] += c * 5;
+    c = h[0] >> 44;
+    h[0] &= MASK44;
+    h[1] += c;
+}
+
+// The reference kernel: h = (h + m) * r for each 16-byte block
+static void poly1305_blocks_scalar(Poly1305Ctx *ctx, const uint8_t *m, size_t blocks, uint64_t hibit) {
+    // Work on copies: m could alias the context, which would force reloads
+    uint64_t h[3] = { ctx->h[0], ctx->h[1], ctx->h[2] };
+    const uint64_t r[3] = { ctx->r[0], ctx->r[1], ctx->r[2] };
+    for (size_t i = 0; i < blocks; ++i, m += POLY1305_BLOCK_SIZE) {
+        uint64_t t0 = load64_le(m), t1 = load64_le(m + 8);
+        h[0] += t0 & MASK44;
+        h[1] += ((t0 >> 44) | (t1 << 20)) & MASK44;
+        h[2] += ((t1 >> 24) & MASK42) | hibit;
+        poly1305_mul(h, r);
+    }
+    ctx->h[0] = h[0];
+    ctx->h[1] = h[1];
+    ctx->h[2] = h[2];
+}
+
+// --- Kernel dispatch ---
+
+typedef void (*poly1305_kernel_fn)(Poly1305Ctx *ctx, const uint8_t *m, size_t blocks);
+
+typedef struct {
+    const char *name;
+    poly1305_kernel_fn fn;
+    size_t blocks;        // Calls take a multiple of this many full blocks
+    int (*supported)(void);
+} Poly1305Impl;
+
+static void poly1305_full_blocks_scalar(Poly1305Ctx *ctx, const uint8_t *m, size_t blocks) {
+    poly1305_blocks_scalar(ctx, m, blocks, HIBIT);
+}
+
+static int cpu_always(void) { return 1; }
+#ifdef POLY1305_HAVE_X86_SIMD
+static void poly1305_full_blocks_avx2(Poly1305Ctx *ctx, const uint8_t *m, size_t blocks) {
+    poly1305_blocks_avx2(ctx->h, (const uint32_t (*)[5])ctx->powers, m, blocks);
+}
+static int cpu_avx2(void) { __builtin_cpu_init(); return __builtin_cpu_supports("avx2"); }
+#endif
+
+// Candidates, best first. The scalar entry must stay last.
+static const Poly1305Impl poly1305_impls[] = {
+#ifdef POLY1305_HAVE_X86_SIMD
+    { "avx2", poly1305_full_blocks_avx2, POLY1305_AVX2_BLOCKS, cpu_avx2 },
+#endif
+    { "scalar", poly1305_full_blocks_scalar, 1, cpu_always },
+};
+#define POLY1305_IMPL_COUNT (sizeof(poly1305_impls) / sizeof(poly1305_impls[0]))
+
+static int poly1305_active = DISPATCH_UNSET; // Index into poly1305_impls
+
+static void poly1305_update_with(Poly1305Ctx *ctx, const Poly1305Impl *impl, const uint8_t *m, size_t len);
+
+// Known-answer check of a kernel against the scalar reference. The key and
+// message are all ones, which puts every limb at its largest, and the length
+// leaves a partial block so the tail handling is covered too.
+static int poly1305_impl_selftest(const Poly1305Impl *impl) {
+    uint8_t key[POLY1305_KEY_SIZE], m[16 * 16 + 5], expected[POLY1305_TAG_SIZE], actual[POLY1305_TAG_SIZE];
+    Poly1305Ctx ctx;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < sizeof(key); ++i) key[i] = pass ? (uint8_t)(i * 29 + 3) : 0xFF;
+        for (size_t i = 0; i < sizeof(m); ++i) m[i] = pass ? (uint8_t)(i * 7) : 0xFF;
+
+        poly1305_init(&ctx, key);
+        poly1305_update_with(&ctx, &poly1305_impls[POLY1305_IMPL_COUNT - 1], m, sizeof(m));
+        poly1305_final(&ctx, expected);
+        poly1305_init(&ctx, key);
+        poly1305_update_with(&ctx, impl, m, sizeof(m));
+        poly1305_final(&ctx, actual);
+        if (memcmp(expected, actual, sizeof(expected)) != 0) return 0;
+    }
+    return 1;
+}
+
+static int poly1305_impl_usable(size_t index) {
+    const Poly1305Impl *impl = &poly1305_impls[index];
+    return impl->supported() && poly1305_impl_selftest(impl);
+}
+
+static const Poly1305Impl *poly1305_get_impl(void) {
+    return &poly1305_impls[dispatch_get(&poly1305_active, POLY1305_IMPL_COUNT, poly1305_impl_usable)];
+}
+
+const char *poly1305_impl_name(void) {
+    return poly1305_get_impl()->name;
+}
+
+int poly1305_set_impl(const char *name) {
+    for (size_t i = 0; i < POLY1305_IMPL_COUNT; ++i) {
+        if (strcmp(poly1305_impls[i].name, name) == 0) {
+            if (!poly1305_impl_usable(i)) return -1;
+            dispatch_set(&poly1305_active, i);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// --- Streaming API ---
+
+// Stores a 44/44/42-bit value as five 26-bit limbs
+static void poly1305_to_26(uint32_t out[5], const uint64_t v[3]) {
+    uint64_t v1 = v[1] & MASK44, v2 = v[2] + (v[1] >> 44);
+    out[0] = (uint32_t)(v[0] & MASK26);
+    out[1] = (uint32_t)(((v[0] >> 26) | (v1 << 18)) & MASK26);
+    out[2] = (uint32_t)((v1 >> 8) & MASK26);
+    out[3] = (uint32_t)(((v1 >> 34) | (v2 << 10)) & MASK26);
+    out[4] = (uint32_t)(v2 >> 16);
+}
+
+void poly1305_init(Poly1305Ctx *ctx, const uint8_t key[POLY1305_KEY_SIZE]) {
+    uint64_t t0 = load64_le(key), t1 = load64_le(key + 8);
+
+    // r is clamped as the RFC requires
+    ctx->r[0] = t0 & 0xffc0fffffffULL;
+    ctx->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+    ctx->r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+    ctx->h[0] = ctx->h[1] = ctx->h[2] = 0;
+    ctx->pad[0] = load64_le(key + 16);
+    ctx->pad[1] = load64_le(key + 24);
+    ctx->leftover = 0;
+
+    // r^1..r^4 for the multi-block kernel, stored highest power first
+    uint64_t p[3] = { ctx->r[0], ctx->r[1], ctx->r[2] };
+    poly1305_to_26(ctx->powers[3], p);
+    for (int i = 2; i >= 0; --i) {
+        poly1305_mul(p, ctx->r);
+        poly1305_to_26(ctx->powers[i], p);
+    }
+}
+
+static void poly1305_update_with(Poly1305Ctx *ctx, const Poly1305Impl *impl, const uint8_t *m, size_t len) {
+    // Complete a block left over from the previous call
+    if (ctx->leftover) {
+        size_t n = POLY1305_BLOCK_SIZE - ctx->leftover < len ? POLY1305_BLOCK_SIZE - ctx->leftover : len;
+        memcpy(ctx->buffer + ctx->leftover, m, n);
+        ctx->leftover += n;
+        m += n;
+        len -= n;
+        if (ctx->leftover < POLY1305_BLOCK_SIZE) return;
+        poly1305_blocks_scalar(ctx, ctx->buffer, 1, HIBIT);
+        ctx->leftover = 0;
+    }
+
+    // Whole blocks: as many as possible through the kernel, the rest one by one
+    size_t blocks = len / POLY1305_BLOCK_SIZE;
+    if (impl->blocks > 1 && blocks >= impl->blocks) {
+        size_t n = blocks - blocks % impl->blocks;
+        impl->fn(ctx, m, n);
+        m += n * POLY1305_BLOCK_SIZE;
+        blocks -= n;
+    }
+    poly1305_blocks_scalar(ctx, m, blocks, HIBIT);
+    m += blocks * POLY1305_BLOCK_SIZE;
+    len %= POLY1305_BLOCK_SIZE;
+
+    memcpy(ctx->buffer, m, len);
+    ctx->leftover = len;
+}
+
+void poly1305_update(Poly1305Ctx *ctx, const uint8_t *m, size_t len) {
+    poly1305_update_with(ctx, poly1305_get_impl(), m, len);
+}
+
+void poly1305_pad16(Poly1305Ctx *ctx) {
+    if (!ctx->leftover) return;
+    memset(ctx->buffer + ctx->leftover, 0, POLY1305_BLOCK_SIZE - ctx->leftover);
+    poly1305_blocks_scalar(ctx, ctx->buffer, 1, HIBIT);
+    ctx->leftover = 0;
+}
+
+void poly1305_final(Poly1305Ctx *ctx, uint8_t tag[POLY1305_TAG_SIZE]) {
+    // A final partial block gets a 1 byte after the message instead of 2^128
+    if (ctx->leftover) {
+        ctx->buffer[ctx->leftover] = 1;
+        memset(ctx->buffer + ctx->leftover + 1, 0, POLY1305_BLOCK_SIZE - ctx->leftover - 1);
+        poly1305_blocks_scalar(ctx, ctx->buffer, 1, 0);
+    }
+
+    // Carry fully, then subtract p if h >= p, without branching on h
+    uint64_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2], c;
+    c = h1 >> 44; h1 &= MASK44; h2 += c;
+    c = h2 >> 42; h2 &= MASK42; h0 += c * 5;
+    c = h0 >> 44; h0 &= MASK44; h1 += c;
+    c = h1 >> 44; h1 &= MASK44; h2 += c;
+    c = h2 >> 42; h2 &= MASK42; h0 += c * 5;
+    c = h0 >> 44; h0 &= MASK44; h1 += c;
+
+    uint64_t g0 = h0 + 5;
+    c = g0 >> 44; g0 &= MASK44;
+    uint64_t g1 = h1 + c;
+    c = g1 >> 44; g1 &= MASK44;
+    uint64_t g2 = h2 + c - (1ULL << 42);
+    uint64_t mask = (g2 >> 63) - 1; // All ones if h - p did not go negative
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+
+    // tag = (h + s) mod 2^128
+    uint64_t t0 = ctx->pad[0], t1 = ctx->pad[1];
+    h0 += t0 & MASK44;
+    c = h0 >> 44; h0 &= MASK44;
+    h1 += (((t0 >> 44) | (t1 << 20)) & MASK44) + c;
+    c = h1 >> 44; h1 &= MASK44;
+    h2 += ((t1 >> 24) & MASK42) + c;
+    h2 &= MASK42;
+
+    store64_le(tag, h0 | (h1 << 44));
+    store64_le(tag + 8, (h1 >> 20) | (h2 << 24));
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int poly1305_verify(const uint8_t a[POLY1305_TAG_SIZE], const uint8_t b[POLY1305_TAG_SIZE]) {
+    uint8_t diff = 0;
+    for (int i = 0; i < POLY1305_TAG_SIZE; ++i) diff |= a[i] ^ b[i];
+    return diff == 0 ? 0 : -1;
+}
@@ -0,0 +1,49 @@
+#ifndef POLY1305_H
+#define POLY1305_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define POLY1305_KEY_SIZE 32
+#define POLY1305_TAG_SIZE 16
+#define POLY1305_BLOCK_SIZE 16
+
+// Streaming state. The accumulator and r are kept in three 44/44/42-bit limbs
+// so a block costs nine 64x64->128-bit multiplies. The powers r^1..r^4 are
+// precomputed for the multi-block SIMD kernel, which runs four interleaved
+// accumulators in 26-bit limbs.
+typedef struct {
+    uint64_t r[3];
+    uint64_t h[3];
+    uint64_t pad[2];
+    uint32_t powers[4][5];             // r^4, r^3, r^2, r^1 in 26-bit limbs (SIMD kernel only)
+    uint8_t buffer[POLY1305_BLOCK_SIZE];
+    size_t leftover;                   // Bytes waiting in buffer
+} Poly1305Ctx;
+
+// Starts a MAC under a one-time key (r || s, as in RFC 8439).
+void poly1305_init(Poly1305Ctx *ctx, const uint8_t key[POLY1305_KEY_SIZE]);
+
+// Absorbs len more bytes of the message. Calls can use any lengths.
+void poly1305_update(Poly1305Ctx *ctx, const uint8_t *m, size_t len);
+
+// Pads the message with zeros to a whole block, as the AEAD construction does
+// between its AAD and ciphertext. No-op when the length so far is a multiple of 16.
+void poly1305_pad16(Poly1305Ctx *ctx);
+
+// Writes the tag and wipes the state.
+void poly1305_final(Poly1305Ctx *ctx, uint8_t tag[POLY1305_TAG_SIZE]);
+
+// Compares two tags in constant time. Returns 0 if they are equal, -1 otherwise.
+int poly1305_verify(const uint8_t a[POLY1305_TAG_SIZE], const uint8_t b[POLY1305_TAG_SIZE]);
+
+// Name of the block kernel in use: "avx2" or "scalar". Picked on first use
+// after checking it against the scalar reference, as for ChaCha20.
+const char *poly1305_impl_name(void);
+
+// Forces a specific kernel by name. Returns 0 on success, -1 if the kernel
+// is unknown or unsupported here. Takes effect on live contexts too, from
+// their next poly1305_update() call.
+int poly1305_set_impl(const char *name);
+
+#endif // POLY1305_H
@@ -0,0 +1,116 @@
+#include "poly1305_simd.h"
+
+#ifdef POLY1305_HAVE_X86_SIMD
+#include <immintrin.h>
+
+// The AVX2 kernel runs four accumulators side by side, one per 64-bit lane,
+// each in five 26-bit limbs so that _mm256_mul_epu32 (32x32->64) products and
+// their sums stay well inside 64 bits. Lane j takes blocks j, j+4, j+8, ...:
+// every step multiplies all lanes by r^4 and adds the next four blocks, and
+// the last step multiplies the lanes by r^4, r^3, r^2 and r^1 instead, so the
+// lane sum equals the sequential h = (h + m) * r over all the blocks.
+
+#define MASK26 0x3ffffffu
+#define MASK44 0xfffffffffffULL
+
+// Splits four consecutive 16-byte blocks into 26-bit limbs, adding the 2^128 bit
+__attribute__((target("avx2")))
+static inline void load_blocks(__m256i t[5], const uint8_t* m) {
+    const __m256i mask = _mm256_set1_epi64x(MASK26);
+    __m256i a = _mm256_loadu_si256((const __m256i*)m);
+    __m256i b = _mm256_loadu_si256((const __m256i*)(m + 32));
+    // Low and high halves of blocks 0..3, in block order
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+    t[0] = _mm256_and_si256(lo, mask);
+    t[1] = _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask);
+    t[2] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52), _mm256_slli_epi64(hi, 12)), mask);
+    t[3] = _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask);
+    t[4] = _mm256_or_si256(_mm256_srli_epi64(hi, 40), _mm256_set1_epi64x(1 << 24));
+}
+
+// h = h * r mod 2^130 - 5 in every lane; s holds 5 * r for the wrapped terms.
+// Inputs may be up to 2^27 per limb; outputs are carried back to about 2^26.
+__attribute__((target("avx2")))
+static inline void mul_reduce(__m256i h[5], const __m256i r[5], const __m256i s[5]) {
+#define MUL(a, b) _mm256_mul_epu32(a, b)
+#define ADD(a, b) _mm256_add_epi64(a, b)
+    __m256i d0 = ADD(ADD(ADD(ADD(MUL(h[0], r[0]), MUL(h[1], s[4])), MUL(h[2], s[3])), MUL(h[3], s[2])), MUL(h[4], s[1]));
+    __m256i d1 = ADD(ADD(ADD(ADD(MUL(h[0], r[1]), MUL(h[1], r[0])), MUL(h[2], s[4])), MUL(h[3], s[3])), MUL(h[4], s[2]));
+    __m256i d2 = ADD(ADD(ADD(ADD(MUL(h[0], r[2]), MUL(h[1], r[1])), MUL(h[2], r[0])), MUL(h[3], s[4])), MUL(h[4], s[3]));
+    __m256i d3 = ADD(ADD(ADD(ADD(MUL(h[0], r[3]), MUL(h[1], r[2])), MUL(h[2], r[1])), MUL(h[3], r[0])), MUL(h[4], s[4]));
+    __m256i d4 = ADD(ADD(ADD(ADD(MUL(h[0], r[4]), MUL(h[1], r[3])), MUL(h[2], r[2])), MUL(h[3], r[1])), MUL(h[4], r[0]));
+
+    const __m256i mask = _mm256_set1_epi64x(MASK26);
+    __m256i c;
+    c = _mm256_srli_epi64(d0, 26); d0 = _mm256_and_si256(d0, mask); d1 = ADD(d1, c);
+    c = _mm256_srli_epi64(d1, 26); d1 = _mm256_and_si256(d1, mask); d2 = ADD(d2, c);
+    c = _mm256_srli_epi64(d2, 26); d2 = _mm256_and_si256(d2, mask); d3 = ADD(d3, c);
+    c = _mm256_srli_epi64(d3, 26); d3 = _mm256_and_si256(d3, mask); d4 = ADD(d4, c);
+    c = _mm256_srli_epi64(d4, 26); d4 = _mm256_and_si256(d4, mask);
+    d0 = ADD(d0, ADD(c, _mm256_slli_epi64(c, 2)));
+    c = _mm256_srli_epi64(d0, 26); d0 = _mm256_and_si256(d0, mask); d1 = ADD(d1, c);
+#undef MUL
+#undef ADD
+    h[0] = d0; h[1] = d1; h[2] = d2; h[3] = d3; h[4] = d4;
+}
+
+// 5 * r for limbs 1..4 (limb 0 is never wrapped)
+__attribute__((target("avx2")))
+static inline void times5(__m256i s[5], const __m256i r[5]) {
+    s[0] = r[0];
+    for (int i = 1; i < 5; ++i) s[i] = _mm256_add_epi64(r[i], _mm256_slli_epi64(r[i], 2));
+}
+
+__attribute__((target("avx2")))
+void poly1305_blocks_avx2(uint64_t h[3], const uint32_t powers[4][5], const uint8_t* m, size_t blocks) {
+    __m256i r4[5], s4[5], rn[5], sn[5], acc[5], t[5];
+    for (int i = 0; i < 5; ++i) {
+        r4[i] = _mm256_set1_epi64x(powers[0][i]);
+        rn[i] = _mm256_setr_epi64x(powers[0][i], powers[1][i], powers[2][i], powers[3][i]);
+    }
+    times5(s4, r4);
+    times5(sn, rn);
+
+    // The running accumulator joins lane 0, the first block of the first group
+    uint64_t h1 = h[1] & MASK44, h2 = h[2] + (h[1] >> 44);
+    uint64_t h26[5] = {
+        h[0] & MASK26,
+        ((h[0] >> 26) | (h1 << 18)) & MASK26,
+        (h1 >> 8) & MASK26,
+        ((h1 >> 34) | (h2 << 10)) & MASK26,
+        h2 >> 16,
+    };
+    load_blocks(acc, m);
+    for (int i = 0; i < 5; ++i) acc[i] = _mm256_add_epi64(acc[i], _mm256_setr_epi64x((long long)h26[i], 0, 0, 0));
+    m += 4 * 16;
+
+    for (size_t done = 4; done < blocks; done += 4) {
+        mul_reduce(acc, r4, s4);
+        load_blocks(t, m);
+        for (int i = 0; i < 5; ++i) acc[i] = _mm256_add_epi64(acc[i], t[i]);
+        m += 4 * 16;
+    }
+    mul_reduce(acc, rn, sn);
+
+    // Sum the lanes and carry back into 44/44/42-bit limbs
+    uint64_t d[5];
+    for (int i = 0; i < 5; ++i) {
+        uint64_t lane[4];
+        _mm256_storeu_si256((__m256i*)lane, acc[i]);
+        d[i] = lane[0] + lane[1] + lane[2] + lane[3];
+    }
+    uint64_t c;
+    c = d[0] >> 26; d[0] &= MASK26; d[1] += c;
+    c = d[1] >> 26; d[1] &= MASK26; d[2] += c;
+    c = d[2] >> 26; d[2] &= MASK26; d[3] += c;
+    c = d[3] >> 26; d[3] &= MASK26; d[4] += c;
+    c = d[4] >> 26; d[4] &= MASK26; d[0] += c * 5;
+    uint64_t lo = d[0] + (d[1] << 26);
+    uint64_t mid = (lo >> 44) + (d[2] << 8) + (d[3] << 34);
+    h[0] = lo & MASK44;
+    h[1] = mid & MASK44;
+    h[2] = (mid >> 44) + (d[4] << 16);
+}
+
+#endif // POLY1305_HAVE_X86_SIMD
@@ -0,0 +1,20 @@
+#ifndef POLY1305_SIMD_H
+#define POLY1305_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Internal multi-block Poly1305 kernels used by poly1305.c.
+// Each kernel absorbs a multiple of POLY1305_<ISA>_BLOCKS full 16-byte blocks
+// into the accumulator h (44/44/42-bit limbs, fully carried, as kept by
+// poly1305.c). powers holds r^4, r^3, r^2 and r^1 in five 26-bit limbs each.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define POLY1305_HAVE_X86_SIMD 1
+
+#define POLY1305_AVX2_BLOCKS 4
+
+void poly1305_blocks_avx2(uint64_t h[3], const uint32_t powers[4][5], const uint8_t *m, size_t blocks);
+#endif
+
+#endif // POLY1305_SIMD_H
@@ -1,14 +1,67 @@
 #include "rsa.h"
 #include <string.h>
-#include <stdlib.h> // For rand()
-#include <stdio.h>
-
-// A simple (and not cryptographically secure) random byte generator for padding.
-// For a real-world app, use a proper CSPRNG.
-static void generate_random_bytes(uint8_t* buf, size_t len) {
-    for (size_t i = 0; i < len; ++i) {
-        buf[i] = rand() & 0xFF;
+#include "drbg.h"
+
+int rsa_prepare_key(RsaKey* key) {
+    if (bignum_mont_init(&key->mont, &key->modulus) != 0) {
+        return -1;
+    }
+    if (key->has_crt &&
+        (bignum_mont_init(&key->p_mont, &key->p) != 0 || bignum_mont_init(&key->q_mont, &key->q) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+int rsa_load_key(RsaKey* key, const uint8_t* data, size_t len) {
+    size_t k = 0;
+    int has_crt = 0;
+    for (size_t bytes = RSA_MIN_KEY_BYTES; bytes <= RSA_MAX_KEY_BYTES; bytes += RSA_KEY_BYTES_STEP) {
+        if (len == RSA_KEY_FILE_BYTES(bytes)) { k = bytes; break; }
+        if (len == RSA_CRT_KEY_FILE_BYTES(bytes)) { k = bytes; has_crt = 1; break; }
     }
+    if (k == 0) return -1;
+
+    const size_t half = k / 2;
+    key->bytes = k;
+    bignum_from_bytes(&key->modulus, data, k);
+    bignum_from_bytes(&key->exponent, data + k, k);
+
+    key->has_crt = has_crt;
+    if (key->has_crt) {
+        const uint8_t* crt = data + RSA_KEY_FILE_BYTES(k);
+        bignum_from_bytes(&key->p, crt + 0 * half, half);
+        bignum_from_bytes(&key->q, crt + 1 * half, half);
+        bignum_from_bytes(&key->dp, crt + 2 * half, half);
+        bignum_from_bytes(&key->dq, crt + 3 * half, half);
+        bignum_from_bytes(&key->qinv, crt + 4 * half, half);
+    }
+    return rsa_prepare_key(key);
+}
+
+int rsa_pad_pkcs1(uint8_t* block, size_t block_len, const uint8_t* data, size_t data_len) {
+    if (block_len < RSA_PKCS1_OVERHEAD || data_len > block_len - RSA_PKCS1_OVERHEAD) return -1;
+
+    size_t pad_end = block_len - data_len - 1;
+    block[0] = 0x00;
+    block[1] = 0x02; // Block type 2 for encryption
+    // Fill with random non-zero bytes
+    if (drbg_fill_nonzero(block + 2, pad_end - 2) != 0) return -1;
+    block[pad_end] = 0x00;
+    memcpy(block + pad_end + 1, data, data_len);
+    return 0;
+}
+
+int rsa_unpad_pkcs1(const uint8_t* block, size_t block_len, size_t* data_offset) {
+    if (block_len < RSA_PKCS1_OVERHEAD || block[0] != 0x00 || block[1] != 0x02) return -1;
+
+    // Find the 0x00 separator
+    size_t i = 2;
+    while (i < block_len && block[i] != 0x00) { i++; }
+
+    if (i >= block_len || i < 10) return -1; // At least 8 random bytes + separator
+    *data_offset = i + 1; // Move past the separator
+    return 0;
 }
 
 // RSA with PKCS#1 v1.5 padding
@@ -16,25 +69,29 @@ static void generate_random_bytes(uint8_t* buf, size_t len) {
 int rsa_crypt(uint8_t* out, size_t* out_len, const uint8_t* in, size_t in_len, const RsaKey* key) {
     Bignum m, c;
 
-    // if (in_len > RSA_KEY_BYTES - 11) {
-    //     // Data too large for this key size with PKCS#1.5 padding
-    //     fprintf(stderr, "Error: RSA data size is too large.\n");
-    //     return -1;
-    // }
+    if (in_len > key->bytes) return -1;
 
     // This is a simplified check. Public exponent is usually small (e.g., 65537).
     // Private exponent is large. We can infer encrypt vs decrypt from exponent size,
     // but for this project, we'll assume the same function is called.
     
     // --- Step 1: Convert input bytes to a bignum ---
-    bignum_from_bytes(&m, in, RSA_KEY_BYTES);
+    bignum_from_bytes(&m, in, in_len);
 
     // --- Step 2: Perform modular exponentiation ---
-    bignum_mod_exp(&c, &m, &key->exponent, &key->modulus);
+    if (key->has_crt) {
+        // Two half-size exponentiations mod p and q, then recombine
+        Bignum m1, m2;
+        bignum_mod_exp_mont(&m1, &m, &key->dp, &key->p_mont);
+        bignum_mod_exp_mont(&m2, &m, &key->dq, &key->q_mont);
+        bignum_crt_combine(&c, &m1, &m2, &key->q, &key->qinv, &key->p_mont);
+    } else {
+        bignum_mod_exp_mont(&c, &m, &key->exponent, &key->mont);
+    }
     
     // --- Step 3: Convert result back to bytes ---
-    bignum_to_bytes(&c, out, RSA_KEY_BYTES);
-    *out_len = RSA_KEY_BYTES;
+    bignum_to_bytes(&c, out, key->bytes);
+    *out_len = key->bytes;
 
     return 0;
 }
\ No newline at end of file
@@ -4,17 +4,61 @@
 #include "bignum.h"
 #include <stddef.h>
 
-#define RSA_KEY_BITS 1024
-#define RSA_KEY_BYTES (RSA_KEY_BITS / 8)
+// Nothing here prints: failures come back as -1 and callers report them.
 
-// For RSA, key is composed of the exponent and the modulus
+// Supported modulus sizes: 1024 to 4096 bits in steps of 512.
+// The size of a key is taken from its key file, see rsa_load_key().
+#define RSA_MIN_KEY_BYTES 128
+#define RSA_MAX_KEY_BYTES (BIGNUM_MAX_BITS / 8)
+#define RSA_KEY_BYTES_STEP 64
+
+// Key file layouts for a modulus of K bytes, every value big-endian and
+// zero-padded to its field size (CRT fields are K/2 bytes):
+//   public or plain private: n | e (or d)                       2 * K
+//   CRT private:             n | d | p | q | dP | dQ | qInv     2 * K + 5 * K/2
+// The two sizes never collide for the supported values of K.
+#define RSA_KEY_FILE_BYTES(k) (2 * (k))
+#define RSA_CRT_KEY_FILE_BYTES(k) (RSA_KEY_FILE_BYTES(k) + 5 * ((k) / 2))
+
+// For RSA, key is composed of the exponent and the modulus.
+// Private keys may also carry the CRT parameters for faster decryption.
 typedef struct {
+    size_t bytes;    // Modulus size in bytes; every block is exactly this long
     Bignum modulus;
     Bignum exponent;
+    BignumMont mont; // Montgomery context for the modulus, see rsa_prepare_key()
+
+    int has_crt;     // Set when the fields below are valid
+    Bignum p, q;     // Prime factors of the modulus
+    Bignum dp, dq;   // d mod (p-1), d mod (q-1)
+    Bignum qinv;     // q^-1 mod p
+    BignumMont p_mont, q_mont;
 } RsaKey;
 
+// Parses a key file in either layout above, inferring the modulus size from
+// the file length, and prepares it for use.
+// Returns 0 on success, -1 if the size or the values are invalid.
+int rsa_load_key(RsaKey* key, const uint8_t* data, size_t len);
+
+// Precomputes the per-modulus Montgomery contexts. Call once after filling in the key.
+// Returns 0 on success, -1 if the modulus is invalid.
+int rsa_prepare_key(RsaKey* key);
+
+// PKCS#1 v1.5 encryption padding needs 11 bytes per block
+#define RSA_PKCS1_OVERHEAD 11
+
+// Builds a PKCS#1 v1.5 type 2 block of block_len bytes around data:
+// 0x00 0x02 <random non-zero bytes> 0x00 <data>.
+// Returns 0 on success, -1 if data does not fit or no random bytes are available.
+int rsa_pad_pkcs1(uint8_t* block, size_t block_len, const uint8_t* data, size_t data_len);
+
+// Checks a decrypted PKCS#1 v1.5 type 2 block and locates the data in it.
+// On success stores the data offset in *data_offset (data runs to the end of the
+// block) and returns 0; returns -1 if the padding is invalid.
+int rsa_unpad_pkcs1(const uint8_t* block, size_t block_len, size_t* data_offset);
+
 // RSA encryption/decryption function. Uses PKCS#1 v1.5 padding.
-// Returns 0 on success, -1 on failure.
+// Returns 0 on success, -1 if in is longer than the modulus.
 int rsa_crypt(uint8_t* out, size_t* out_len, const uint8_t* in, size_t in_len, const RsaKey* key);
 
 #endif // RSA_H
\ No newline at end of file
@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200809L
+#include "stats.h"
+#include <time.h>
+
+int stats_enabled = 0;
+
+static uint64_t timers[STAT_TIMER_COUNT];
+static uint64_t counters[STAT_COUNTER_COUNT];
+static uint64_t latency[STATS_LATENCY_BUCKETS];
+static uint64_t latency_total_ns;
+static uint64_t latency_max_ns;
+
+static const char* timer_names[STAT_TIMER_COUNT] = { "read", "write", "crypto", "io_wait" };
+static const char* counter_names[STAT_COUNTER_COUNT] = {
+    "bytes_read", "bytes_written", "chacha20_blocks", "tea_blocks", "modexp"
+};
+
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void stats_record(StatTimer timer, uint64_t start_ns) {
+    __atomic_fetch_add(&timers[timer], stats_now_ns() - start_ns, __ATOMIC_RELAXED);
+}
+
+void stats_count(StatCounter counter, uint64_t n) {
+    __atomic_fetch_add(&counters[counter], n, __ATOMIC_RELAXED);
+}
+
+void stats_rsa_latency(uint64_t start_ns) {
+    uint64_t ns = stats_now_ns() - start_ns;
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+    while (us > 0 && bucket < STATS_LATENCY_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    __atomic_fetch_add(&latency[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&latency_total_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counters[STAT_MODEXP], 1, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&latency_max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&latency_max_ns, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Upper bound of a latency bucket in microseconds
+static uint64_t bucket_limit_us(int bucket) {
+    return (uint64_t)1 << bucket;
+}
+
+static void print_duration_us(FILE* f, uint64_t us) {
+    if (us >= 1000000) fprintf(f, "%llu s", (unsigned long long)(us / 1000000));
+    else if (us >= 1000) fprintf(f, "%llu ms", (unsigned long long)(us / 1000));
+    else fprintf(f, "%llu us", (unsigned long long)us);
+}
+
+void stats_print(FILE* f, uint64_t wall_ns) {
+    double wall = wall_ns / 1e9;
+    fprintf(f, "--- stats ---\n");
+    fprintf(f, "wall time      %10.3f s\n", wall);
+    for (int t = 0; t < STAT_TIMER_COUNT; ++t) {
+        double s = timers[t] / 1e9;
+        fprintf(f, "%-14s %10.3f s  (%5.1f%% of wall)\n", timer_names[t], s, wall > 0 ? 100.0 * s / wall : 0.0);
+    }
+    fprintf(f, "bytes read     %14llu", (unsigned long long)counters[STAT_BYTES_READ]);
+    if (timers[STAT_READ]) fprintf(f, "  (%.1f MB/s while reading)", counters[STAT_BYTES_READ] / (timers[STAT_READ] / 1e3));
+    fprintf(f, "\nbytes written  %14llu", (unsigned long long)counters[STAT_BYTES_WRITTEN]);
+    if (timers[STAT_WRITE]) fprintf(f, "  (%.1f MB/s while writing)", counters[STAT_BYTES_WRITTEN] / (timers[STAT_WRITE] / 1e3));
+    fprintf(f, "\n");
+    if (timers[STAT_CRYPTO]) {
+        fprintf(f, "crypto speed   %10.1f MB/s of input\n", counters[STAT_BYTES_READ] / (timers[STAT_CRYPTO] / 1e3));
+    }
+    fprintf(f, "chacha20 blocks %13llu\n", (unsigned long long)counters[STAT_CHACHA20_BLOCKS]);
+    fprintf(f, "tea blocks     %14llu\n", (unsigned long long)counters[STAT_TEA_BLOCKS]);
+
+    uint64_t ops = counters[STAT_MODEXP];
+    fprintf(f, "rsa modexp     %14llu\n", (unsigned long long)ops);
+    if (ops == 0) return;
+    fprintf(f, "rsa latency    mean %.3f ms, max %.3f ms\n", latency_total_ns / 1e6 / ops, latency_max_ns / 1e6);
+    for (int b = 0; b < STATS_LATENCY_BUCKETS; ++b) {
+        if (!latency[b]) continue;
+        fprintf(f, "  [");
+        print_duration_us(f, b ? bucket_limit_us(b - 1) : 0);
+        fprintf(f, ", ");
+        if (b == STATS_LATENCY_BUCKETS - 1) fprintf(f, "inf");
+        else print_duration_us(f, bucket_limit_us(b));
+        fprintf(f, "): %llu\n", (unsigned long long)latency[b]);
+    }
+}
+
+void stats_print_json(FILE* f, uint64_t wall_ns) {
+    fprintf(f, "{\"wall_ns\": %llu", (unsigned long long)wall_ns);
+    for (int t = 0; t < STAT_TIMER_COUNT; ++t) {
+        fprintf(f, ", \"%s_ns\": %llu", timer_names[t], (unsigned long long)timers[t]);
+    }
+    for (int c = 0; c < STAT_COUNTER_COUNT; ++c) {
+        fprintf(f, ", \"%s\": %llu", counter_names[c], (unsigned long long)counters[c]);
+    }
+    fprintf(f, ", \"rsa_latency\": {\"total_ns\": %llu, \"max_ns\": %llu, \"buckets\": [",
+            (unsigned long long)latency_total_ns, (unsigned long long)latency_max_ns);
+    // Each bucket as {"le_us": upper bound, "count": n}; the last one is unbounded
+    int first = 1;
+    for (int b = 0; b < STATS_LATENCY_BUCKETS; ++b) {
+        if (!latency[b]) continue;
+        fprintf(f, "%s{\"le_us\": ", first ? "" : ", ");
+        if (b == STATS_LATENCY_BUCKETS - 1) fprintf(f, "null");
+        else fprintf(f, "%llu", (unsigned long long)bucket_limit_us(b));
+        fprintf(f, ", \"count\": %llu}", (unsigned long long)latency[b]);
+        first = 0;
+    }
+    fprintf(f, "]}}\n");
+}
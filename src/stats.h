@@ -0,0 +1,64 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Optional instrumentation of the hot paths (--stats). Stages are timed with
+// the monotonic clock and counters are updated atomically, so worker threads
+// can report too. Everything is gated on stats_enabled and hooked in per chunk
+// rather than per block, so with stats off the cost is one predictable branch.
+
+typedef enum {
+    STAT_READ,     // Reading input (pipeline reader thread or stdio)
+    STAT_WRITE,    // Writing output (pipeline writer thread or stdio)
+    STAT_CRYPTO,   // Cipher work, including page faults on mapped files
+    STAT_IO_WAIT,  // Processing thread blocked on I/O (empty input slot, io_uring wait)
+    STAT_TIMER_COUNT
+} StatTimer;
+
+typedef enum {
+    STAT_BYTES_READ,      // Everything read from the input, headers and tags included
+    STAT_BYTES_WRITTEN,   // Everything written to the output, headers and tags included
+    STAT_CHACHA20_BLOCKS, // 64-byte keystream blocks
+    STAT_TEA_BLOCKS,      // 8-byte blocks: keystream for tea-ctr, cipher blocks for tea
+    STAT_MODEXP,          // RSA modular exponentiations (one per block; CRT pairs count once)
+    STAT_COUNTER_COUNT
+} StatCounter;
+
+// RSA latency histogram: bucket i counts operations in [2^(i-1), 2^i) microseconds
+#define STATS_LATENCY_BUCKETS 24
+
+extern int stats_enabled;
+
+uint64_t stats_now_ns(void);
+
+// Start time for stats_stop(), or 0 when stats are off
+static inline uint64_t stats_start(void) {
+    return stats_enabled ? stats_now_ns() : 0;
+}
+
+void stats_record(StatTimer timer, uint64_t start_ns);
+void stats_count(StatCounter counter, uint64_t n);
+void stats_rsa_latency(uint64_t start_ns);
+
+static inline void stats_stop(StatTimer timer, uint64_t start_ns) {
+    if (stats_enabled) stats_record(timer, start_ns);
+}
+
+static inline void stats_add(StatCounter counter, uint64_t n) {
+    if (stats_enabled) stats_count(counter, n);
+}
+
+// Records one modexp and its latency
+static inline void stats_modexp(uint64_t start_ns) {
+    if (stats_enabled) stats_rsa_latency(start_ns);
+}
+
+// Prints the summary of everything recorded, against wall_ns of total run time
+void stats_print(FILE* f, uint64_t wall_ns);
+
+// Same as a JSON object
+void stats_print_json(FILE* f, uint64_t wall_ns);
+
+#endif // STATS_H
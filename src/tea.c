@@ -1,4 +1,8 @@
 #include "tea.h"
+#include "tea_simd.h"
+#include "dispatch.h"
+
+#include <string.h>
 
 // Encrypt a 64-bit block with a 128-bit key.
 // v is a 2-element array of 32-bit unsigned integers.
@@ -32,4 +36,232 @@ void tea_decrypt(uint32_t* v, const uint32_t* k) {
     }
     v[0] = v0;
     v[1] = v1;
-}
\ No newline at end of file
+}
+
+// --- Kernel dispatch ---
+
+typedef void (*tea_kernel_fn)(uint32_t* v, const uint32_t* k);
+
+typedef struct {
+    const char* name;
+    tea_kernel_fn encrypt;
+    tea_kernel_fn decrypt;
+    size_t blocks;        // Blocks processed per call
+    int (*supported)(void);
+} TeaImpl;
+
+// Portable kernel: a few blocks run through the rounds side by side, so their
+// independent dependency chains overlap instead of stalling on one block.
+#define TEA_INTERLEAVE 4
+
+static void tea_encrypt_interleaved(uint32_t* v, const uint32_t* k) {
+    uint32_t v0[TEA_INTERLEAVE], v1[TEA_INTERLEAVE], sum = 0;
+    uint32_t delta = 0x9e3779b9;
+    for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+        v0[j] = v[2 * j];
+        v1[j] = v[2 * j + 1];
+    }
+    for (int i = 0; i < 32; i++) {
+        sum += delta;
+        for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+            v0[j] += ((v1[j] << 4) + k[0]) ^ (v1[j] + sum) ^ ((v1[j] >> 5) + k[1]);
+        }
+        for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+            v1[j] += ((v0[j] << 4) + k[2]) ^ (v0[j] + sum) ^ ((v0[j] >> 5) + k[3]);
+        }
+    }
+    for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+        v[2 * j] = v0[j];
+        v[2 * j + 1] = v1[j];
+    }
+}
+
+static void tea_decrypt_interleaved(uint32_t* v, const uint32_t* k) {
+    uint32_t v0[TEA_INTERLEAVE], v1[TEA_INTERLEAVE];
+    uint32_t sum = 0xC6EF3720;
+    uint32_t delta = 0x9e3779b9;
+    for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+        v0[j] = v[2 * j];
+        v1[j] = v[2 * j + 1];
+    }
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+            v1[j] -= ((v0[j] << 4) + k[2]) ^ (v0[j] + sum) ^ ((v0[j] >> 5) + k[3]);
+        }
+        for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+            v0[j] -= ((v1[j] << 4) + k[0]) ^ (v1[j] + sum) ^ ((v1[j] >> 5) + k[1]);
+        }
+        sum -= delta;
+    }
+    for (int j = 0; j < TEA_INTERLEAVE; ++j) {
+        v[2 * j] = v0[j];
+        v[2 * j + 1] = v1[j];
+    }
+}
+
+static int cpu_always(void) { return 1; }
+#ifdef TEA_HAVE_X86_SIMD
+static int cpu_sse2(void) { __builtin_cpu_init(); return __builtin_cpu_supports("sse2"); }
+static int cpu_avx2(void) { __builtin_cpu_init(); return __builtin_cpu_supports("avx2"); }
+static int cpu_avx512(void) { __builtin_cpu_init(); return __builtin_cpu_supports("avx512f"); }
+#endif
+
+// Candidates, best first. The scalar entry must stay last.
+static const TeaImpl tea_impls[] = {
+#ifdef TEA_HAVE_X86_SIMD
+    { "avx512", tea_encrypt_avx512, tea_decrypt_avx512, TEA_AVX512_BLOCKS, cpu_avx512 },
+    { "avx2", tea_encrypt_avx2, tea_decrypt_avx2, TEA_AVX2_BLOCKS, cpu_avx2 },
+    { "sse2", tea_encrypt_sse2, tea_decrypt_sse2, TEA_SSE2_BLOCKS, cpu_sse2 },
+#endif
+    { "scalar", tea_encrypt_interleaved, tea_decrypt_interleaved, TEA_INTERLEAVE, cpu_always },
+};
+#define TEA_IMPL_COUNT (sizeof(tea_impls) / sizeof(tea_impls[0]))
+#define TEA_MAX_KERNEL_BLOCKS 16
+
+static int tea_active = DISPATCH_UNSET; // Index into tea_impls
+
+// Known-answer check of a kernel against the single-block reference, in both directions
+static int tea_impl_selftest(const TeaImpl* impl) {
+    uint32_t k[4] = { 0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210 };
+    uint32_t plain[2 * TEA_MAX_KERNEL_BLOCKS], expected[2 * TEA_MAX_KERNEL_BLOCKS], actual[2 * TEA_MAX_KERNEL_BLOCKS];
+
+    for (size_t i = 0; i < 2 * TEA_MAX_KERNEL_BLOCKS; ++i) plain[i] = (uint32_t)(i * 0x9E3779B1u + 0x7F4A7C15u);
+    memcpy(expected, plain, sizeof(plain));
+    for (size_t b = 0; b < impl->blocks; ++b) tea_encrypt(expected + 2 * b, k);
+
+    memcpy(actual, plain, sizeof(plain));
+    impl->encrypt(actual, k);
+    if (memcmp(actual, expected, 2 * impl->blocks * sizeof(uint32_t)) != 0) return 0;
+    impl->decrypt(actual, k);
+    return memcmp(actual, plain, 2 * impl->blocks * sizeof(uint32_t)) == 0;
+}
+
+static int tea_impl_usable(size_t index) {
+    const TeaImpl* impl = &tea_impls[index];
+    return impl->supported() && tea_impl_selftest(impl);
+}
+
+static const TeaImpl* tea_get_impl(void) {
+    return &tea_impls[dispatch_get(&tea_active, TEA_IMPL_COUNT, tea_impl_usable)];
+}
+
+const char* tea_impl_name(void) {
+    return tea_get_impl()->name;
+}
+
+int tea_set_impl(const char* name) {
+    for (size_t i = 0; i < TEA_IMPL_COUNT; ++i) {
+        if (strcmp(tea_impls[i].name, name) == 0) {
+            if (!tea_impl_usable(i)) return -1;
+            dispatch_set(&tea_active, i);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// --- Multi-block and CBC ---
+
+void tea_encrypt_blocks(uint32_t* v, size_t blocks, const uint32_t* k) {
+    const TeaImpl* impl = tea_get_impl();
+    size_t b = 0;
+    for (; b + impl->blocks <= blocks; b += impl->blocks) impl->encrypt(v + 2 * b, k);
+    for (; b < blocks; ++b) tea_encrypt(v + 2 * b, k);
+}
+
+void tea_decrypt_blocks(uint32_t* v, size_t blocks, const uint32_t* k) {
+    const TeaImpl* impl = tea_get_impl();
+    size_t b = 0;
+    for (; b + impl->blocks <= blocks; b += impl->blocks) impl->decrypt(v + 2 * b, k);
+    for (; b < blocks; ++b) tea_decrypt(v + 2 * b, k);
+}
+
+// Blocks handed to the multi-block kernels per call by the modes below,
+// a multiple of every kernel width
+#define TEA_GROUP_BLOCKS 32
+
+static void xor_block(uint8_t* a, const uint8_t* b) {
+    for (int i = 0; i < TEA_BLOCK_SIZE; ++i) a[i] ^= b[i];
+}
+
+// Blocks and key go through memcpy, which keeps the in-memory (native endian)
+// word order of the original per-block code without unaligned casts.
+void tea_cbc_encrypt(uint8_t* buf, size_t len, const uint8_t key[TEA_KEY_SIZE], uint8_t iv[TEA_BLOCK_SIZE]) {
+    if (len == 0) return;
+    uint32_t k[4], v[2];
+    memcpy(k, key, TEA_KEY_SIZE);
+
+    const uint8_t* chain = iv;
+    for (size_t i = 0; i < len; i += TEA_BLOCK_SIZE) {
+        xor_block(buf + i, chain);
+        memcpy(v, buf + i, TEA_BLOCK_SIZE);
+        tea_encrypt(v, k);
+        memcpy(buf + i, v, TEA_BLOCK_SIZE);
+        chain = buf + i;
+    }
+    memcpy(iv, chain, TEA_BLOCK_SIZE);
+}
+
+
+// Walks the buffer backwards a group of blocks at a time: each group is
+// decrypted into a scratch copy, so the ciphertext it chains from is still
+// intact in buf when it is XORed in.
+void tea_cbc_decrypt(uint8_t* buf, size_t len, const uint8_t key[TEA_KEY_SIZE], uint8_t iv[TEA_BLOCK_SIZE]) {
+    if (len == 0) return;
+    uint32_t k[4], v[2 * TEA_GROUP_BLOCKS];
+    uint8_t next_iv[TEA_BLOCK_SIZE];
+    memcpy(k, key, TEA_KEY_SIZE);
+    memcpy(next_iv, buf + len - TEA_BLOCK_SIZE, TEA_BLOCK_SIZE);
+
+    size_t blocks = len / TEA_BLOCK_SIZE;
+    while (blocks > 0) {
+        size_t count = blocks < TEA_GROUP_BLOCKS ? blocks : TEA_GROUP_BLOCKS;
+        blocks -= count;
+        uint8_t* group = buf + blocks * TEA_BLOCK_SIZE;
+
+        memcpy(v, group, count * TEA_BLOCK_SIZE);
+        tea_decrypt_blocks(v, count, k);
+        uint8_t* plain = (uint8_t*)v;
+        xor_block(plain, blocks > 0 ? group - TEA_BLOCK_SIZE : iv);
+        for (size_t j = 1; j < count; ++j) {
+            xor_block(plain + j * TEA_BLOCK_SIZE, group + (j - 1) * TEA_BLOCK_SIZE);
+        }
+        memcpy(group, v, count * TEA_BLOCK_SIZE);
+    }
+    memcpy(iv, next_iv, TEA_BLOCK_SIZE);
+}
+
+size_t tea_cbc_padding_length(const uint8_t last_block[TEA_BLOCK_SIZE]) {
+    uint8_t padding_val = last_block[TEA_BLOCK_SIZE - 1];
+    return (padding_val > 0 && padding_val <= TEA_BLOCK_SIZE) ? padding_val : 0;
+}
+
+void tea_ctr_crypt(uint8_t* out, const uint8_t* in, size_t len, const uint8_t key[TEA_KEY_SIZE],
+                   uint64_t iv, uint64_t offset) {
+    uint32_t k[4], v[2 * TEA_GROUP_BLOCKS];
+    memcpy(k, key, TEA_KEY_SIZE);
+
+    uint64_t block = offset / TEA_BLOCK_SIZE;
+    size_t skip = offset % TEA_BLOCK_SIZE; // Keystream bytes to drop from the first block
+    while (len > 0) {
+        size_t count = (skip + len + TEA_BLOCK_SIZE - 1) / TEA_BLOCK_SIZE;
+        if (count > TEA_GROUP_BLOCKS) count = TEA_GROUP_BLOCKS;
+        for (size_t j = 0; j < count; ++j) {
+            uint64_t counter = iv + block + j;
+            v[2 * j] = (uint32_t)(counter >> 32);
+            v[2 * j + 1] = (uint32_t)counter;
+        }
+        tea_encrypt_blocks(v, count, k);
+
+        const uint8_t* keystream = (const uint8_t*)v + skip;
+        size_t n = count * TEA_BLOCK_SIZE - skip;
+        if (n > len) n = len;
+        for (size_t i = 0; i < n; ++i) out[i] = in[i] ^ keystream[i];
+
+        out += n;
+        in += n;
+        len -= n;
+        block += count;
+        skip = 0;
+    }
+}
@@ -14,4 +14,40 @@ void tea_encrypt(uint32_t* v, const uint32_t* k);
 // Decrypts a single 8-byte block using a 16-byte key.
 void tea_decrypt(uint32_t* v, const uint32_t* k);
 
+// Encrypts or decrypts consecutive blocks in place (v holds 2 words per block,
+// as for a single block). Independent blocks go through the widest kernel the
+// CPU supports, several at a time.
+void tea_encrypt_blocks(uint32_t* v, size_t blocks, const uint32_t* k);
+void tea_decrypt_blocks(uint32_t* v, size_t blocks, const uint32_t* k);
+
+// CBC-encrypts len bytes (a multiple of TEA_BLOCK_SIZE) in place. iv holds the
+// ciphertext block before buf and is updated to the last block of buf, so a
+// stream can be processed in consecutive chunks.
+void tea_cbc_encrypt(uint8_t* buf, size_t len, const uint8_t key[TEA_KEY_SIZE], uint8_t iv[TEA_BLOCK_SIZE]);
+
+// CBC-decrypts len bytes (a multiple of TEA_BLOCK_SIZE) in place, chaining the
+// same way as tea_cbc_encrypt().
+void tea_cbc_decrypt(uint8_t* buf, size_t len, const uint8_t key[TEA_KEY_SIZE], uint8_t iv[TEA_BLOCK_SIZE]);
+
+// Number of plaintext bytes to drop from a decrypted final block (PKCS#7).
+// Files written by earlier builds have no padding block when the input was
+// block-aligned, so a block without valid padding is kept whole (returns 0).
+size_t tea_cbc_padding_length(const uint8_t last_block[TEA_BLOCK_SIZE]);
+
+// Counter mode: keystream block i is the encryption of the 64-bit counter
+// iv + i (mod 2^64), high word first. Encrypts or decrypts len bytes starting
+// at byte offset of the stream, so any range can be processed independently.
+// out may equal in.
+void tea_ctr_crypt(uint8_t* out, const uint8_t* in, size_t len, const uint8_t key[TEA_KEY_SIZE],
+                   uint64_t iv, uint64_t offset);
+
+// Name of the multi-block kernel in use: "avx512", "avx2", "sse2" or "scalar".
+// The best kernel the CPU supports is picked on first use, after checking it
+// against the single-block reference.
+const char* tea_impl_name(void);
+
+// Forces a specific kernel by name (e.g. "scalar" for comparisons).
+// Returns 0 on success, -1 if the kernel is unknown or unsupported here.
+int tea_set_impl(const char* name);
+
 #endif // TEA_H
\ No newline at end of file
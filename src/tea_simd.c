@@ -0,0 +1,122 @@
+#include "tea_simd.h"
+
+#ifdef TEA_HAVE_X86_SIMD
+#include <immintrin.h>
+
+// Each kernel splits its blocks into a vector of first words (y) and a vector
+// of second words (z), one block per lane, and runs the 32 rounds on all lanes
+// at once. The split and the merge back are each one pair of shuffles.
+
+#define TEA_DELTA 0x9e3779b9u
+#define TEA_DECRYPT_SUM 0xC6EF3720u
+
+// 32 encryption rounds, parameterized by the ISA's operations
+#define TEA_ENCRYPT_ROUNDS(ADD, XOR, SLL, SRL, SET1, y, z, k) do {                      \
+        __typeof__(y) sum = SET1(0), delta = SET1(TEA_DELTA);                          \
+        __typeof__(y) k0 = SET1(k[0]), k1 = SET1(k[1]), k2 = SET1(k[2]), k3 = SET1(k[3]); \
+        for (int i = 0; i < 32; i++) {                                                 \
+            sum = ADD(sum, delta);                                                     \
+            y = ADD(y, XOR(XOR(ADD(SLL(z, 4), k0), ADD(z, sum)), ADD(SRL(z, 5), k1))); \
+            z = ADD(z, XOR(XOR(ADD(SLL(y, 4), k2), ADD(y, sum)), ADD(SRL(y, 5), k3))); \
+        }                                                                              \
+    } while (0)
+
+// 32 decryption rounds, the exact inverse of TEA_ENCRYPT_ROUNDS
+#define TEA_DECRYPT_ROUNDS(ADD, SUB, XOR, SLL, SRL, SET1, y, z, k) do {                 \
+        __typeof__(y) sum = SET1(TEA_DECRYPT_SUM), delta = SET1(TEA_DELTA);            \
+        __typeof__(y) k0 = SET1(k[0]), k1 = SET1(k[1]), k2 = SET1(k[2]), k3 = SET1(k[3]); \
+        for (int i = 0; i < 32; i++) {                                                 \
+            z = SUB(z, XOR(XOR(ADD(SLL(y, 4), k2), ADD(y, sum)), ADD(SRL(y, 5), k3))); \
+            y = SUB(y, XOR(XOR(ADD(SLL(z, 4), k0), ADD(z, sum)), ADD(SRL(z, 5), k1))); \
+            sum = SUB(sum, delta);                                                     \
+        }                                                                              \
+    } while (0)
+
+// --- SSE2: 4 blocks ---
+
+#define SSE2_SET1(x) _mm_set1_epi32((int)(x))
+
+// a and b hold blocks 0-1 and 2-3; y and z get the first and second words
+#define SSE2_SPLIT(a, b, y, z) do {                                                     \
+        y = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), 0x88)); \
+        z = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), 0xDD)); \
+    } while (0)
+
+__attribute__((target("sse2")))
+void tea_encrypt_sse2(uint32_t* v, const uint32_t* k) {
+    __m128i a = _mm_loadu_si128((const __m128i*)v), b = _mm_loadu_si128((const __m128i*)(v + 4)), y, z;
+    SSE2_SPLIT(a, b, y, z);
+    TEA_ENCRYPT_ROUNDS(_mm_add_epi32, _mm_xor_si128, _mm_slli_epi32, _mm_srli_epi32, SSE2_SET1, y, z, k);
+    _mm_storeu_si128((__m128i*)v, _mm_unpacklo_epi32(y, z));
+    _mm_storeu_si128((__m128i*)(v + 4), _mm_unpackhi_epi32(y, z));
+}
+
+__attribute__((target("sse2")))
+void tea_decrypt_sse2(uint32_t* v, const uint32_t* k) {
+    __m128i a = _mm_loadu_si128((const __m128i*)v), b = _mm_loadu_si128((const __m128i*)(v + 4)), y, z;
+    SSE2_SPLIT(a, b, y, z);
+    TEA_DECRYPT_ROUNDS(_mm_add_epi32, _mm_sub_epi32, _mm_xor_si128, _mm_slli_epi32, _mm_srli_epi32, SSE2_SET1, y, z, k);
+    _mm_storeu_si128((__m128i*)v, _mm_unpacklo_epi32(y, z));
+    _mm_storeu_si128((__m128i*)(v + 4), _mm_unpackhi_epi32(y, z));
+}
+
+// --- AVX2: 8 blocks ---
+
+// The shuffles work within 128-bit lanes, so the lanes end up holding blocks
+// 0 1 4 5 | 2 3 6 7. That order is undone exactly by the unpacks on the way out.
+#define AVX2_SET1(x) _mm256_set1_epi32((int)(x))
+
+#define AVX2_SPLIT(a, b, y, z) do {                                                         \
+        y = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), 0x88)); \
+        z = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), 0xDD)); \
+    } while (0)
+
+__attribute__((target("avx2")))
+void tea_encrypt_avx2(uint32_t* v, const uint32_t* k) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)v), b = _mm256_loadu_si256((const __m256i*)(v + 8)), y, z;
+    AVX2_SPLIT(a, b, y, z);
+    TEA_ENCRYPT_ROUNDS(_mm256_add_epi32, _mm256_xor_si256, _mm256_slli_epi32, _mm256_srli_epi32, AVX2_SET1, y, z, k);
+    _mm256_storeu_si256((__m256i*)v, _mm256_unpacklo_epi32(y, z));
+    _mm256_storeu_si256((__m256i*)(v + 8), _mm256_unpackhi_epi32(y, z));
+}
+
+__attribute__((target("avx2")))
+void tea_decrypt_avx2(uint32_t* v, const uint32_t* k) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)v), b = _mm256_loadu_si256((const __m256i*)(v + 8)), y, z;
+    AVX2_SPLIT(a, b, y, z);
+    TEA_DECRYPT_ROUNDS(_mm256_add_epi32, _mm256_sub_epi32, _mm256_xor_si256, _mm256_slli_epi32, _mm256_srli_epi32,
+                       AVX2_SET1, y, z, k);
+    _mm256_storeu_si256((__m256i*)v, _mm256_unpacklo_epi32(y, z));
+    _mm256_storeu_si256((__m256i*)(v + 8), _mm256_unpackhi_epi32(y, z));
+}
+
+// --- AVX-512: 16 blocks ---
+
+// Same in-lane split as AVX2, across four 128-bit lanes
+#define AVX512_SET1(x) _mm512_set1_epi32((int)(x))
+
+#define AVX512_SPLIT(a, b, y, z) do {                                                       \
+        y = _mm512_castps_si512(_mm512_shuffle_ps(_mm512_castsi512_ps(a), _mm512_castsi512_ps(b), 0x88)); \
+        z = _mm512_castps_si512(_mm512_shuffle_ps(_mm512_castsi512_ps(a), _mm512_castsi512_ps(b), 0xDD)); \
+    } while (0)
+
+__attribute__((target("avx512f")))
+void tea_encrypt_avx512(uint32_t* v, const uint32_t* k) {
+    __m512i a = _mm512_loadu_si512((const void*)v), b = _mm512_loadu_si512((const void*)(v + 16)), y, z;
+    AVX512_SPLIT(a, b, y, z);
+    TEA_ENCRYPT_ROUNDS(_mm512_add_epi32, _mm512_xor_si512, _mm512_slli_epi32, _mm512_srli_epi32, AVX512_SET1, y, z, k);
+    _mm512_storeu_si512((void*)v, _mm512_unpacklo_epi32(y, z));
+    _mm512_storeu_si512((void*)(v + 16), _mm512_unpackhi_epi32(y, z));
+}
+
+__attribute__((target("avx512f")))
+void tea_decrypt_avx512(uint32_t* v, const uint32_t* k) {
+    __m512i a = _mm512_loadu_si512((const void*)v), b = _mm512_loadu_si512((const void*)(v + 16)), y, z;
+    AVX512_SPLIT(a, b, y, z);
+    TEA_DECRYPT_ROUNDS(_mm512_add_epi32, _mm512_sub_epi32, _mm512_xor_si512, _mm512_slli_epi32, _mm512_srli_epi32,
+                       AVX512_SET1, y, z, k);
+    _mm512_storeu_si512((void*)v, _mm512_unpacklo_epi32(y, z));
+    _mm512_storeu_si512((void*)(v + 16), _mm512_unpackhi_epi32(y, z));
+}
+
+#endif // TEA_HAVE_X86_SIMD
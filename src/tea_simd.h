@@ -0,0 +1,26 @@
+#ifndef TEA_SIMD_H
+#define TEA_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Internal multi-block TEA kernels used by tea.c.
+// Each kernel encrypts or decrypts TEA_<ISA>_BLOCKS consecutive blocks in place.
+// v holds two words per block, in the same order as tea_encrypt()/tea_decrypt().
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TEA_HAVE_X86_SIMD 1
+
+#define TEA_SSE2_BLOCKS 4
+#define TEA_AVX2_BLOCKS 8
+#define TEA_AVX512_BLOCKS 16
+
+void tea_encrypt_sse2(uint32_t* v, const uint32_t* k);
+void tea_decrypt_sse2(uint32_t* v, const uint32_t* k);
+void tea_encrypt_avx2(uint32_t* v, const uint32_t* k);
+void tea_decrypt_avx2(uint32_t* v, const uint32_t* k);
+void tea_encrypt_avx512(uint32_t* v, const uint32_t* k);
+void tea_decrypt_avx512(uint32_t* v, const uint32_t* k);
+#endif
+
+#endif // TEA_SIMD_H
@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include "threadpool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct ThreadPool {
+    pthread_t* threads;          // The pool_size() - 1 background workers
+    size_t worker_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;   // Signalled when a job is posted or on shutdown
+    pthread_cond_t work_done;    // Signalled when the last task of a job finishes
+
+    // Current job, protected by lock
+    pool_task_fn fn;
+    void* arg;
+    size_t count;                // Number of tasks in the job
+    size_t next;                 // Next index to hand out
+    size_t pending;              // Tasks not yet finished
+    int shutdown;
+};
+
+// Claims and runs tasks until the current job has none left. Called with the lock held.
+static void pool_work(ThreadPool* pool) {
+    while (pool->next < pool->count) {
+        size_t index = pool->next++;
+        pool_task_fn fn = pool->fn;
+        void* arg = pool->arg;
+
+        pthread_mutex_unlock(&pool->lock);
+        fn(arg, index);
+        pthread_mutex_lock(&pool->lock);
+
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+}
+
+static void* pool_worker(void* arg) {
+    ThreadPool* pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->next >= pool->count) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        pool_work(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+size_t pool_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
+
+ThreadPool* pool_create(size_t threads) {
+    if (threads == 0) threads = pool_default_threads();
+
+    ThreadPool* pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    if (threads > 1) {
+        pool->threads = malloc((threads - 1) * sizeof(pthread_t));
+        if (!pool->threads) {
+            pool_destroy(pool);
+            return NULL;
+        }
+        for (size_t i = 0; i < threads - 1; ++i) {
+            if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) break;
+            pool->worker_count++;
+        }
+    }
+    return pool;
+}
+
+size_t pool_size(const ThreadPool* pool) {
+    return pool->worker_count + 1;
+}
+
+void pool_run(ThreadPool* pool, size_t count, pool_task_fn fn, void* arg) {
+    if (count == 0) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->count = count;
+    pool->next = 0;
+    pool->pending = count;
+    pthread_cond_broadcast(&pool->work_ready);
+
+    // Help out, then wait for the tasks still running on workers
+    pool_work(pool);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pool->count = 0;
+    pool->next = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_destroy(ThreadPool* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->worker_count; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool);
+}
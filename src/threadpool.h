@@ -0,0 +1,30 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h>
+
+// A fixed set of worker threads that run parallel-for style jobs.
+// The calling thread also works on each job, so a pool of N threads
+// starts N - 1 workers and a pool of 1 runs everything inline.
+typedef struct ThreadPool ThreadPool;
+
+// Task callback: called once for every index in [0, count)
+typedef void (*pool_task_fn)(void* arg, size_t index);
+
+// Number of online CPUs (at least 1)
+size_t pool_default_threads(void);
+
+// Creates a pool with the given number of threads (0 means pool_default_threads()).
+// Returns NULL on failure.
+ThreadPool* pool_create(size_t threads);
+
+// Total number of threads working on each job, including the caller
+size_t pool_size(const ThreadPool* pool);
+
+// Runs fn(arg, i) for every i in [0, count) and waits until all calls return.
+void pool_run(ThreadPool* pool, size_t count, pool_task_fn fn, void* arg);
+
+// Stops the workers and frees the pool
+void pool_destroy(ThreadPool* pool);
+
+#endif // THREADPOOL_H